@@ -0,0 +1,154 @@
+// File: src/cancel.c
+#define _GNU_SOURCE
+#include "cancel.h"
+#include "resource_registry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+struct CancelToken {
+    atomic_int cancelled;
+    int fd;
+    pthread_mutex_t mutex;
+    CancelWatch *watches;
+};
+
+unsigned long long monotonic_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+unsigned long long deadline_after_ms(unsigned long ms) {
+    return monotonic_now_ns() + (unsigned long long)ms * 1000000ULL;
+}
+
+int deadline_timeout_ms(unsigned long long deadline_ns, int limit_ms) {
+    if (deadline_ns == 0) {
+        return limit_ms;
+    }
+    unsigned long long now = monotonic_now_ns();
+    if (now >= deadline_ns) {
+        return 0;
+    }
+    // Round up so a wait never ends just short of the deadline
+    unsigned long long left = (deadline_ns - now + 999999ULL) / 1000000ULL;
+    if (left > INT32_MAX) {
+        left = INT32_MAX;
+    }
+    return limit_ms >= 0 && (unsigned long long)limit_ms < left ? limit_ms : (int)left;
+}
+
+int deadline_passed(unsigned long long deadline_ns) {
+    return deadline_ns != 0 && monotonic_now_ns() >= deadline_ns;
+}
+
+CancelToken *cancel_token_create(void) {
+    CancelToken *token = calloc(1, sizeof(*token));
+    if (token == NULL) {
+        return NULL;
+    }
+    token->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (token->fd == -1) {
+        free(token);
+        return NULL;
+    }
+    // Written to by cancel_token_cancel(); must survive EH_FD_CLEANUP=all
+    protect_fd(token->fd);
+    pthread_mutex_init(&token->mutex, NULL);
+    return token;
+}
+
+void cancel_token_destroy(CancelToken *token) {
+    if (token == NULL) {
+        return;
+    }
+    unprotect_fd(token->fd);
+    close(token->fd);
+    pthread_mutex_destroy(&token->mutex);
+    free(token);
+}
+
+void cancel_token_cancel(CancelToken *token) {
+    if (token == NULL || atomic_exchange(&token->cancelled, 1)) {
+        return;
+    }
+    uint64_t one = 1;
+    if (write(token->fd, &one, sizeof(one)) < 0) {
+        perror("cancel_token_cancel");
+    }
+    pthread_mutex_lock(&token->mutex);
+    for (CancelWatch *watch = token->watches; watch != NULL; watch = watch->next) {
+        pthread_mutex_lock(watch->mutex);
+        pthread_cond_broadcast(watch->cond);
+        pthread_mutex_unlock(watch->mutex);
+    }
+    pthread_mutex_unlock(&token->mutex);
+}
+
+int cancel_token_cancelled(const CancelToken *token) {
+    return token != NULL && atomic_load(&((CancelToken *)token)->cancelled);
+}
+
+int cancel_token_fd(const CancelToken *token) {
+    return token ? token->fd : -1;
+}
+
+void cancel_token_watch(CancelToken *token, CancelWatch *watch, pthread_mutex_t *mutex, pthread_cond_t *cond) {
+    if (token == NULL) {
+        return;
+    }
+    watch->mutex = mutex;
+    watch->cond = cond;
+    pthread_mutex_lock(&token->mutex);
+    watch->next = token->watches;
+    token->watches = watch;
+    pthread_mutex_unlock(&token->mutex);
+}
+
+void cancel_token_unwatch(CancelToken *token, CancelWatch *watch) {
+    if (token == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&token->mutex);
+    for (CancelWatch **link = &token->watches; *link != NULL; link = &(*link)->next) {
+        if (*link == watch) {
+            *link = watch->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&token->mutex);
+}
+
+int cancel_sleep_until(CancelToken *token, unsigned long long until_ns) {
+    struct timespec until = { (time_t)(until_ns / 1000000000ULL), (long)(until_ns % 1000000000ULL) };
+    if (token == NULL) {
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR) {
+        }
+        return 0;
+    }
+
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t cond;
+    pthread_condattr_t attr;
+    CancelWatch watch;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    cancel_token_watch(token, &watch, &mutex, &cond);
+    pthread_mutex_lock(&mutex);
+    while (!cancel_token_cancelled(token) &&
+           pthread_cond_timedwait(&cond, &mutex, &until) != ETIMEDOUT) {
+    }
+    pthread_mutex_unlock(&mutex);
+    cancel_token_unwatch(token, &watch);
+    pthread_cond_destroy(&cond);
+    return cancel_token_cancelled(token) ? ECANCELED : 0;
+}
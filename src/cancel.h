@@ -0,0 +1,56 @@
+// File: src/cancel.h
+#ifndef CANCEL_H
+#define CANCEL_H
+
+#include <pthread.h>
+
+// Deadlines are absolute CLOCK_MONOTONIC times in nanoseconds; 0 means none
+
+unsigned long long monotonic_now_ns(void);
+
+// The deadline ms milliseconds from now
+unsigned long long deadline_after_ms(unsigned long ms);
+
+// Milliseconds left before deadline_ns, capped at limit_ms (-1 = no cap).
+// -1 when neither bounds the wait, 0 once the deadline has passed.
+int deadline_timeout_ms(unsigned long long deadline_ns, int limit_ms);
+
+int deadline_passed(unsigned long long deadline_ns);
+
+// Lets one thread stop recoveries that others are running once their
+// result is no longer needed. Every function accepts a NULL token.
+typedef struct CancelToken CancelToken;
+
+// Returns NULL if the token cannot be allocated
+CancelToken *cancel_token_create(void);
+
+// Only once no recovery is using the token any more
+void cancel_token_destroy(CancelToken *token);
+
+// Cancel for good: every wait on the token returns with ECANCELED
+void cancel_token_cancel(CancelToken *token);
+
+int cancel_token_cancelled(const CancelToken *token);
+
+// Descriptor that becomes readable once the token is cancelled, for adding
+// to a poll() set; -1 for a NULL token
+int cancel_token_fd(const CancelToken *token);
+
+// Broadcast cond, under mutex, when the token is cancelled, so condition
+// variable waits end too. Register before checking
+// cancel_token_cancelled() under mutex, and call neither function while
+// holding mutex.
+typedef struct CancelWatch {
+    pthread_mutex_t *mutex;
+    pthread_cond_t *cond;
+    struct CancelWatch *next;
+} CancelWatch;
+
+void cancel_token_watch(CancelToken *token, CancelWatch *watch, pthread_mutex_t *mutex, pthread_cond_t *cond);
+void cancel_token_unwatch(CancelToken *token, CancelWatch *watch);
+
+// Sleep until until_ns (CLOCK_MONOTONIC) or until token is cancelled.
+// Returns 0 after a full sleep, ECANCELED if cancelled.
+int cancel_sleep_until(CancelToken *token, unsigned long long until_ns);
+
+#endif // CANCEL_H
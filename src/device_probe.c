@@ -0,0 +1,322 @@
+// File: src/device_probe.c
+#define _GNU_SOURCE
+#include "device_probe.h"
+#include "probe_cache.h"
+#include "strategy_stats.h"
+#include "resource_registry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <termios.h>
+
+// One probing round, shared with its threads; whoever drops the last
+// reference frees it, so the caller can return before a slow probe ends
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int refs;
+    int running;
+    int winner;
+    DeviceProbeOutcome outcome;
+    int ranked;     // Candidates compete; record how each one fared
+    int count;
+    char paths[DEVICE_PROBE_MAX_CANDIDATES][PATH_MAX];
+} ProbeRound;
+
+typedef struct {
+    ProbeRound *round;
+    int index;
+} ProbeTask;
+
+// How long the best-ranked candidate runs alone before the others start
+#define PROBE_HEAD_START_MS 10
+
+// Paths whose probe thread has not returned yet, perhaps stuck in open() on
+// a hung device. Later rounds skip them instead of piling up threads.
+#define PROBES_IN_FLIGHT_MAX (2 * DEVICE_PROBE_MAX_CANDIDATES)
+static pthread_mutex_t in_flight_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char in_flight[PROBES_IN_FLIGHT_MAX][PATH_MAX];
+static int in_flight_count;
+
+static pthread_mutex_t candidates_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t candidates_once = PTHREAD_ONCE_INIT;
+static char candidates[DEVICE_PROBE_MAX_CANDIDATES][PATH_MAX];
+static int candidate_count;
+
+static void parse_candidates(const char *list) {
+    candidate_count = 0;
+    while (*list && candidate_count < DEVICE_PROBE_MAX_CANDIDATES) {
+        size_t len = strcspn(list, ":");
+        if (len > 0 && len < PATH_MAX) {
+            memcpy(candidates[candidate_count], list, len);
+            candidates[candidate_count++][len] = '\0';
+        }
+        list += len;
+        if (*list == ':') {
+            list++;
+        }
+    }
+}
+
+static void read_candidates_from_env(void) {
+    const char *list = getenv("EH_DEVICE_CANDIDATES");
+    parse_candidates(list && list[0] ? list : DEVICE_PROBE_DEFAULT_CANDIDATES);
+}
+
+int set_device_candidates(const char *const *paths, int count) {
+    pthread_once(&candidates_once, read_candidates_from_env);
+    pthread_mutex_lock(&candidates_mutex);
+    candidate_count = 0;
+    for (int i = 0; i < count && candidate_count < DEVICE_PROBE_MAX_CANDIDATES; i++) {
+        if (paths[i] && paths[i][0] && strlen(paths[i]) < PATH_MAX) {
+            strcpy(candidates[candidate_count++], paths[i]);
+        }
+    }
+    int kept = candidate_count;
+    pthread_mutex_unlock(&candidates_mutex);
+    return kept;
+}
+
+static int device_accessible(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return 0;
+    }
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
+    }
+    close(fd);
+    return 1;
+}
+
+static int reset_device(const char *path) {
+    int fd = open(path, O_RDWR | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
+    }
+    protect_fd(fd);
+    ioctl(fd, TIOCEXCL, 0);
+    ioctl(fd, TIOCNXCL, 0);
+    unprotect_fd(fd);
+    close(fd);
+    return 1;
+}
+
+// Returns 0 if path had no probe running and now has one, -1 otherwise
+static int claim_path(const char *path) {
+    int rc = -1;
+    pthread_mutex_lock(&in_flight_mutex);
+    int i = 0;
+    while (i < in_flight_count && strcmp(in_flight[i], path) != 0) {
+        i++;
+    }
+    if (i == in_flight_count && in_flight_count < PROBES_IN_FLIGHT_MAX) {
+        strcpy(in_flight[in_flight_count++], path);
+        rc = 0;
+    }
+    pthread_mutex_unlock(&in_flight_mutex);
+    return rc;
+}
+
+static void unclaim_path(const char *path) {
+    pthread_mutex_lock(&in_flight_mutex);
+    for (int i = 0; i < in_flight_count; i++) {
+        if (strcmp(in_flight[i], path) == 0) {
+            strcpy(in_flight[i], in_flight[--in_flight_count]);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&in_flight_mutex);
+}
+
+static void release_round(ProbeRound *round) {
+    pthread_mutex_lock(&round->mutex);
+    int last = --round->refs == 0;
+    pthread_mutex_unlock(&round->mutex);
+    if (last) {
+        pthread_cond_destroy(&round->cond);
+        pthread_mutex_destroy(&round->mutex);
+        free(round);
+    }
+}
+
+static void add_ms(struct timespec *ts, int ms) {
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static int round_decided(ProbeRound *round) {
+    pthread_mutex_lock(&round->mutex);
+    int decided = round->winner >= 0;
+    pthread_mutex_unlock(&round->mutex);
+    return decided;
+}
+
+static void finish_probe(ProbeRound *round, int index, DeviceProbeOutcome outcome) {
+    pthread_mutex_lock(&round->mutex);
+    if (outcome != DEVICE_PROBE_NONE && round->winner < 0) {
+        round->winner = index;
+        round->outcome = outcome;
+    }
+    round->running--;
+    pthread_cond_broadcast(&round->cond);
+    pthread_mutex_unlock(&round->mutex);
+}
+
+static void *probe_main(void *arg) {
+    ProbeTask task = *(ProbeTask *)arg;
+    ProbeRound *round = task.round;
+    const char *path = round->paths[task.index];
+    DeviceProbeOutcome outcome = DEVICE_PROBE_NONE;
+    free(arg);
+
+    // Open as is, then reset (a side effect, so never first); stop between
+    // steps once another device has won
+    unsigned long long started = strategy_clock_ns();
+    int cut_short = 1;
+    if (!round_decided(round)) {
+        if (probe_cached(path, device_accessible)) {
+            outcome = DEVICE_PROBE_ACCESSIBLE;
+            cut_short = 0;
+        } else if (!round_decided(round)) {
+            if (reset_device(path)) {
+                // A cached failure no longer holds
+                probe_cache_invalidate(path);
+                outcome = DEVICE_PROBE_RESET;
+            }
+            cut_short = 0;
+        }
+    }
+    // A probe stopped by another device's win says nothing about this one
+    if (round->ranked && !cut_short) {
+        strategy_record(DEVICE_ERROR, NULL, path, outcome != DEVICE_PROBE_NONE, strategy_clock_ns() - started);
+    }
+    unclaim_path(path);
+    finish_probe(round, task.index, outcome);
+    release_round(round);
+    return NULL;
+}
+
+DeviceProbeOutcome probe_devices(const char *target, int timeout_ms, CancelToken *cancel, char *device,
+                                 size_t size) {
+    ProbeRound *round = calloc(1, sizeof(*round));
+    if (round == NULL) {
+        return DEVICE_PROBE_NONE;
+    }
+    pthread_mutex_init(&round->mutex, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&round->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    round->winner = -1;
+    round->refs = 1;
+    int order[DEVICE_PROBE_MAX_CANDIDATES];
+
+    if (target != NULL) {
+        round->count = snprintf(round->paths[0], PATH_MAX, "%s", target) < PATH_MAX;
+    } else {
+        pthread_once(&candidates_once, read_candidates_from_env);
+        pthread_mutex_lock(&candidates_mutex);
+        round->count = candidate_count;
+        memcpy(round->paths, candidates, sizeof(candidates));
+        pthread_mutex_unlock(&candidates_mutex);
+    }
+    for (int i = 0; i < round->count; i++) {
+        order[i] = i;
+    }
+    // The candidates are interchangeable, so the one that has recovered
+    // fastest gets a head start; when it wins, the others are never opened
+    if (target == NULL && round->count > 1) {
+        const char *names[DEVICE_PROBE_MAX_CANDIDATES];
+        for (int i = 0; i < round->count; i++) {
+            names[i] = round->paths[i];
+        }
+        strategy_order(DEVICE_ERROR, NULL, names, round->count, order);
+        round->ranked = 1;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    add_ms(&deadline, timeout_ms);
+
+    pthread_attr_t thread_attr;
+    pthread_attr_init(&thread_attr);
+    pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED);
+    for (int n = 0; n < round->count; n++) {
+        int i = order[n];
+        if (n == 1 && round->ranked) {
+            struct timespec head_start;
+            clock_gettime(CLOCK_MONOTONIC, &head_start);
+            add_ms(&head_start, timeout_ms < PROBE_HEAD_START_MS ? timeout_ms : PROBE_HEAD_START_MS);
+            pthread_mutex_lock(&round->mutex);
+            while (round->winner < 0 && round->running > 0) {
+                if (pthread_cond_timedwait(&round->cond, &round->mutex, &head_start) == ETIMEDOUT) {
+                    break;
+                }
+            }
+            int decided = round->winner >= 0;
+            pthread_mutex_unlock(&round->mutex);
+            if (decided) {
+                break;
+            }
+        }
+        if (claim_path(round->paths[i]) != 0) {
+            continue;   // An earlier probe of this device has not returned
+        }
+        ProbeTask *task = malloc(sizeof(*task));
+        if (task == NULL) {
+            unclaim_path(round->paths[i]);
+            break;
+        }
+        *task = (ProbeTask){ round, i };
+        pthread_mutex_lock(&round->mutex);
+        round->refs++;
+        round->running++;
+        pthread_mutex_unlock(&round->mutex);
+        pthread_t thread;
+        if (pthread_create(&thread, &thread_attr, probe_main, task) != 0) {
+            unclaim_path(round->paths[i]);
+            free(task);
+            pthread_mutex_lock(&round->mutex);
+            round->refs--;
+            round->running--;
+            pthread_mutex_unlock(&round->mutex);
+        }
+    }
+    pthread_attr_destroy(&thread_attr);
+
+    CancelWatch watch;
+    cancel_token_watch(cancel, &watch, &round->mutex, &round->cond);
+    pthread_mutex_lock(&round->mutex);
+    while (round->winner < 0 && round->running > 0 && !cancel_token_cancelled(cancel)) {
+        if (pthread_cond_timedwait(&round->cond, &round->mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    DeviceProbeOutcome outcome = round->winner >= 0 ? round->outcome : DEVICE_PROBE_NONE;
+    if (outcome != DEVICE_PROBE_NONE && device != NULL && size > 0) {
+        snprintf(device, size, "%s", round->paths[round->winner]);
+    }
+    if (round->winner < 0) {
+        // Nothing won in time; late successes must not count
+        round->winner = round->count;
+    }
+    pthread_mutex_unlock(&round->mutex);
+    cancel_token_unwatch(cancel, &watch);
+    release_round(round);
+    return outcome;
+}
@@ -0,0 +1,34 @@
+// File: src/device_probe.h
+#ifndef DEVICE_PROBE_H
+#define DEVICE_PROBE_H
+
+#include "cancel.h"
+#include <stddef.h>
+
+#define DEVICE_PROBE_MAX_CANDIDATES 16
+
+// Used when neither EH_DEVICE_CANDIDATES nor set_device_candidates() names any
+#define DEVICE_PROBE_DEFAULT_CANDIDATES "/dev/tty0:/dev/null:/dev/zero"
+
+typedef enum {
+    DEVICE_PROBE_NONE,        // No candidate could be opened in time
+    DEVICE_PROBE_ACCESSIBLE,  // The device opened as it is
+    DEVICE_PROBE_RESET        // The device opened after a TIOCEXCL/TIOCNXCL reset
+} DeviceProbeOutcome;
+
+// Replace the devices recovery tries. EH_DEVICE_CANDIDATES sets the initial
+// list as colon-separated paths. Returns the number kept (at most
+// DEVICE_PROBE_MAX_CANDIDATES).
+int set_device_candidates(const char *const *paths, int count);
+
+// Probe every candidate at once, one thread each, with non-blocking opens.
+// The first device that opens wins and the other probes are told to stop;
+// a probe stuck in the kernel is abandoned rather than waited for, and the
+// device is skipped by later rounds until that probe returns. device
+// (optional) receives the winner's path. A non-NULL target is probed alone
+// instead of the candidates. Cancelling cancel (optional) ends the round
+// like the timeout does.
+DeviceProbeOutcome probe_devices(const char *target, int timeout_ms, CancelToken *cancel, char *device,
+                                 size_t size);
+
+#endif // DEVICE_PROBE_H
@@ -0,0 +1,133 @@
+// File: src/emergency_reserve.c
+#define _GNU_SOURCE
+#include "emergency_reserve.h"
+#include "system_resources.h"
+#include "timer_wheel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#define ARENA_ALIGN 16
+#define REARM_CHECK_MS 1000
+// Re-arm only if memory use, ballast included, stays below this
+#define REARM_MAX_RATIO 0.8
+
+static pthread_mutex_t reserve_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t reserve_once = PTHREAD_ONCE_INIT;
+static size_t ballast_size = EMERGENCY_BALLAST_DEFAULT;
+static void *ballast;
+static char *arena;
+static atomic_size_t arena_used;
+static atomic_int rearm_scheduled;
+
+static void *map_populated(size_t size) {
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    return mem == MAP_FAILED ? NULL : mem;
+}
+
+// Caller holds reserve_mutex
+static int map_ballast(void) {
+    if (ballast != NULL || ballast_size == 0) {
+        return 0;
+    }
+    ballast = map_populated(ballast_size);
+    return ballast ? 0 : -1;
+}
+
+static void unmap_ballast(void) {
+    if (ballast != NULL) {
+        munmap(ballast, ballast_size);
+        ballast = NULL;
+    }
+}
+
+static void reserve_setup(void) {
+    const char *kb = getenv("EH_EMERGENCY_RESERVE_KB");
+    if (kb && kb[0]) {
+        ballast_size = (size_t)strtoull(kb, NULL, 10) * 1024;
+    }
+    arena = map_populated(EMERGENCY_ARENA_SIZE);
+    pthread_mutex_lock(&reserve_mutex);
+    if (map_ballast() != 0) {
+        fprintf(stderr, "Cannot map %zu byte emergency reserve\n", ballast_size);
+    }
+    pthread_mutex_unlock(&reserve_mutex);
+}
+
+void emergency_reserve_init(void) {
+    pthread_once(&reserve_once, reserve_setup);
+}
+
+void emergency_reserve_set_size(size_t bytes) {
+    emergency_reserve_init();
+    pthread_mutex_lock(&reserve_mutex);
+    int armed = ballast != NULL;
+    unmap_ballast();
+    ballast_size = bytes;
+    if (armed) {
+        map_ballast();
+    }
+    pthread_mutex_unlock(&reserve_mutex);
+}
+
+static void rearm_check(void *arg) {
+    (void)arg;
+    unsigned long long limit = memory_limit_bytes();
+    double ballast_ratio = limit ? (double)ballast_size / (double)limit : 0.0;
+    if (memory_usage_ratio() + ballast_ratio < REARM_MAX_RATIO && emergency_reserve_rearm() == 0) {
+        atomic_store(&rearm_scheduled, 0);
+        printf("Emergency memory reserve re-armed\n");
+        return;
+    }
+    if (timer_schedule(REARM_CHECK_MS, rearm_check, NULL) != 0) {
+        atomic_store(&rearm_scheduled, 0);
+    }
+}
+
+size_t emergency_reserve_release(void) {
+    size_t released = 0;
+    emergency_reserve_init();
+    pthread_mutex_lock(&reserve_mutex);
+    if (ballast != NULL) {
+        released = ballast_size;
+        unmap_ballast();
+    }
+    pthread_mutex_unlock(&reserve_mutex);
+
+    if (released > 0 && !atomic_exchange(&rearm_scheduled, 1)) {
+        if (timer_schedule(REARM_CHECK_MS, rearm_check, NULL) != 0) {
+            atomic_store(&rearm_scheduled, 0);
+        }
+    }
+    return released;
+}
+
+int emergency_reserve_rearm(void) {
+    emergency_reserve_init();
+    pthread_mutex_lock(&reserve_mutex);
+    int rc = map_ballast();
+    pthread_mutex_unlock(&reserve_mutex);
+    return rc;
+}
+
+int emergency_reserve_armed(void) {
+    pthread_mutex_lock(&reserve_mutex);
+    int armed = ballast != NULL;
+    pthread_mutex_unlock(&reserve_mutex);
+    return armed;
+}
+
+void *emergency_alloc(size_t size) {
+    emergency_reserve_init();
+    if (arena == NULL || size == 0 || size > EMERGENCY_ARENA_SIZE) {
+        return NULL;
+    }
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    size_t offset = atomic_fetch_add(&arena_used, size);
+    if (offset + size > EMERGENCY_ARENA_SIZE) {
+        return NULL;
+    }
+    return arena + offset;
+}
@@ -0,0 +1,36 @@
+// File: src/emergency_reserve.h
+#ifndef EMERGENCY_RESERVE_H
+#define EMERGENCY_RESERVE_H
+
+#include <stddef.h>
+
+// Ballast mapped when no size is configured; EH_EMERGENCY_RESERVE_KB
+// overrides it and 0 disables the ballast
+#define EMERGENCY_BALLAST_DEFAULT (1024 * 1024)
+
+// Bytes set aside for error records (flight recorder rings and the like)
+#define EMERGENCY_ARENA_SIZE (64 * 1024)
+
+// Map the arena and the ballast, both pre-faulted with MAP_POPULATE so they
+// are resident before memory runs short. error_handler_init() calls this.
+void emergency_reserve_init(void);
+
+// Change the ballast size; takes effect now if the ballast is armed
+void emergency_reserve_set_size(size_t bytes);
+
+// Give the ballast back to the kernel so logging and recovery have room
+// to run. Called when MEMORY_ERROR is raised; the ballast is re-armed by a
+// timer once memory use is below the threshold again. Returns the bytes
+// released, 0 if it was already released.
+size_t emergency_reserve_release(void);
+
+// Map the ballast again. Returns 0 on success or when already armed.
+int emergency_reserve_rearm(void);
+
+int emergency_reserve_armed(void);
+
+// Zeroed, 16-byte aligned memory from the arena for allocations that must
+// not fail when malloc does. Never freed; NULL once the arena is used up.
+void *emergency_alloc(size_t size);
+
+#endif // EMERGENCY_RESERVE_H
@@ -0,0 +1,222 @@
+// File: src/errno_classify.c
+#include "errno_classify.h"
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ERRNO_TABLE_SIZE 134
+
+// One byte per entry: bits 0-3 are type + 1 (0 means "not listed"),
+// bits 4-6 the severity and bit 7 whether a retry may succeed
+#define C(type, severity, retry) (uint8_t)(((type) + 1) | ((severity) << 4) | ((retry) << 7))
+
+static const uint8_t classify_table[ERROR_OP_COUNT][ERRNO_TABLE_SIZE] = {
+    [ERROR_OP_OTHER] = {
+        [ENOMEM] = C(MEMORY_ERROR, SEVERITY_CRITICAL, 1),
+        [EFAULT] = C(NULL_ERROR, SEVERITY_CRITICAL, 0),
+        [EBADF] = C(BAD_FILE_DESCRIPTOR, SEVERITY_ERROR, 0),
+        [EINVAL] = C(INVALID_ARGUMENT, SEVERITY_ERROR, 0),
+        [ENOENT] = C(FILE_ACCESS_ERROR, SEVERITY_ERROR, 1),
+        [EACCES] = C(FILE_ACCESS_ERROR, SEVERITY_ERROR, 0),
+        [EPERM] = C(FILE_ACCESS_ERROR, SEVERITY_ERROR, 0),
+        [EROFS] = C(FILE_ACCESS_ERROR, SEVERITY_ERROR, 0),
+        [EISDIR] = C(FILE_ACCESS_ERROR, SEVERITY_ERROR, 0),
+        [ENOTDIR] = C(FILE_ACCESS_ERROR, SEVERITY_ERROR, 0),
+        [ENAMETOOLONG] = C(FILE_ACCESS_ERROR, SEVERITY_ERROR, 0),
+        [ELOOP] = C(FILE_ACCESS_ERROR, SEVERITY_ERROR, 0),
+        [ENOSPC] = C(FILE_ACCESS_ERROR, SEVERITY_CRITICAL, 1),
+        [EDQUOT] = C(FILE_ACCESS_ERROR, SEVERITY_CRITICAL, 1),
+        [EMFILE] = C(FILE_ACCESS_ERROR, SEVERITY_CRITICAL, 1),
+        [ENFILE] = C(FILE_ACCESS_ERROR, SEVERITY_CRITICAL, 1),
+        [ETXTBSY] = C(TXT_BUSY, SEVERITY_WARNING, 1),
+        [EBUSY] = C(DEVICE_BUSY, SEVERITY_WARNING, 1),
+        [EAGAIN] = C(DEVICE_BUSY, SEVERITY_WARNING, 1),
+        [ETIMEDOUT] = C(DEVICE_BUSY, SEVERITY_WARNING, 1),
+        [ENOTTY] = C(WRONG_DEVICE_COMMAND, SEVERITY_ERROR, 0),
+        [ENODEV] = C(DEVICE_ERROR, SEVERITY_ERROR, 1),
+        [ENXIO] = C(DEVICE_ERROR, SEVERITY_ERROR, 1),
+        [EIO] = C(DEVICE_ERROR, SEVERITY_CRITICAL, 1),
+        [EINTR] = C(UNKNOWN_ERROR, SEVERITY_DEBUG, 1),
+    },
+    [ERROR_OP_DEVICE_OPEN] = {
+        [ENOENT] = C(DEVICE_ERROR, SEVERITY_ERROR, 1),
+        [EACCES] = C(DEVICE_ERROR_ACCESS_FAILURE, SEVERITY_ERROR, 0),
+        [EPERM] = C(DEVICE_ERROR_ACCESS_FAILURE, SEVERITY_ERROR, 0),
+        [EROFS] = C(DEVICE_ERROR_ACCESS_FAILURE, SEVERITY_ERROR, 0),
+    },
+    [ERROR_OP_IOCTL] = {
+        [EINVAL] = C(WRONG_DEVICE_COMMAND, SEVERITY_ERROR, 0),
+    },
+    [ERROR_OP_LOCK] = {
+        [ENOLCK] = C(DEVICE_BUSY, SEVERITY_ERROR, 1),
+        [EDEADLK] = C(DEVICE_BUSY, SEVERITY_ERROR, 0),
+    },
+    [ERROR_OP_EXEC] = {
+        [ENOEXEC] = C(INVALID_ARGUMENT, SEVERITY_ERROR, 0),
+        [E2BIG] = C(INVALID_ARGUMENT, SEVERITY_ERROR, 0),
+    },
+    [ERROR_OP_ALLOC] = {
+        [EAGAIN] = C(MEMORY_ERROR, SEVERITY_CRITICAL, 1),
+    },
+};
+
+static const char *const errno_text[ERRNO_TABLE_SIZE] = {
+    [0] = "Success",
+    [EPERM] = "Operation not permitted",
+    [ENOENT] = "No such file or directory",
+    [ESRCH] = "No such process",
+    [EINTR] = "Interrupted system call",
+    [EIO] = "Input/output error",
+    [ENXIO] = "No such device or address",
+    [E2BIG] = "Argument list too long",
+    [ENOEXEC] = "Exec format error",
+    [EBADF] = "Bad file descriptor",
+    [ECHILD] = "No child processes",
+    [EAGAIN] = "Resource temporarily unavailable",
+    [ENOMEM] = "Cannot allocate memory",
+    [EACCES] = "Permission denied",
+    [EFAULT] = "Bad address",
+    [ENOTBLK] = "Block device required",
+    [EBUSY] = "Device or resource busy",
+    [EEXIST] = "File exists",
+    [EXDEV] = "Invalid cross-device link",
+    [ENODEV] = "No such device",
+    [ENOTDIR] = "Not a directory",
+    [EISDIR] = "Is a directory",
+    [EINVAL] = "Invalid argument",
+    [ENFILE] = "Too many open files in system",
+    [EMFILE] = "Too many open files",
+    [ENOTTY] = "Inappropriate ioctl for device",
+    [ETXTBSY] = "Text file busy",
+    [EFBIG] = "File too large",
+    [ENOSPC] = "No space left on device",
+    [ESPIPE] = "Illegal seek",
+    [EROFS] = "Read-only file system",
+    [EMLINK] = "Too many links",
+    [EPIPE] = "Broken pipe",
+    [EDOM] = "Numerical argument out of domain",
+    [ERANGE] = "Numerical result out of range",
+    [EDEADLOCK] = "Resource deadlock avoided",
+    [ENAMETOOLONG] = "File name too long",
+    [ENOLCK] = "No locks available",
+    [ENOSYS] = "Function not implemented",
+    [ENOTEMPTY] = "Directory not empty",
+    [ELOOP] = "Too many levels of symbolic links",
+    [ENOMSG] = "No message of desired type",
+    [EIDRM] = "Identifier removed",
+    [ECHRNG] = "Channel number out of range",
+    [EL2NSYNC] = "Level 2 not synchronized",
+    [EL3HLT] = "Level 3 halted",
+    [EL3RST] = "Level 3 reset",
+    [ELNRNG] = "Link number out of range",
+    [EUNATCH] = "Protocol driver not attached",
+    [ENOCSI] = "No CSI structure available",
+    [EL2HLT] = "Level 2 halted",
+    [EBADE] = "Invalid exchange",
+    [EBADR] = "Invalid request descriptor",
+    [EXFULL] = "Exchange full",
+    [ENOANO] = "No anode",
+    [EBADRQC] = "Invalid request code",
+    [EBADSLT] = "Invalid slot",
+    [EBFONT] = "Bad font file format",
+    [ENOSTR] = "Device not a stream",
+    [ENODATA] = "No data available",
+    [ETIME] = "Timer expired",
+    [ENOSR] = "Out of streams resources",
+    [ENONET] = "Machine is not on the network",
+    [ENOPKG] = "Package not installed",
+    [EREMOTE] = "Object is remote",
+    [ENOLINK] = "Link has been severed",
+    [EADV] = "Advertise error",
+    [ESRMNT] = "Srmount error",
+    [ECOMM] = "Communication error on send",
+    [EPROTO] = "Protocol error",
+    [EMULTIHOP] = "Multihop attempted",
+    [EDOTDOT] = "RFS specific error",
+    [EBADMSG] = "Bad message",
+    [EOVERFLOW] = "Value too large for defined data type",
+    [ENOTUNIQ] = "Name not unique on network",
+    [EBADFD] = "File descriptor in bad state",
+    [EREMCHG] = "Remote address changed",
+    [ELIBACC] = "Can not access a needed shared library",
+    [ELIBBAD] = "Accessing a corrupted shared library",
+    [ELIBSCN] = ".lib section in a.out corrupted",
+    [ELIBMAX] = "Attempting to link in too many shared libraries",
+    [ELIBEXEC] = "Cannot exec a shared library directly",
+    [EILSEQ] = "Invalid or incomplete multibyte or wide character",
+    [ERESTART] = "Interrupted system call should be restarted",
+    [ESTRPIPE] = "Streams pipe error",
+    [EUSERS] = "Too many users",
+    [ENOTSOCK] = "Socket operation on non-socket",
+    [EDESTADDRREQ] = "Destination address required",
+    [EMSGSIZE] = "Message too long",
+    [EPROTOTYPE] = "Protocol wrong type for socket",
+    [ENOPROTOOPT] = "Protocol not available",
+    [EPROTONOSUPPORT] = "Protocol not supported",
+    [ESOCKTNOSUPPORT] = "Socket type not supported",
+    [ENOTSUP] = "Operation not supported",
+    [EPFNOSUPPORT] = "Protocol family not supported",
+    [EAFNOSUPPORT] = "Address family not supported by protocol",
+    [EADDRINUSE] = "Address already in use",
+    [EADDRNOTAVAIL] = "Cannot assign requested address",
+    [ENETDOWN] = "Network is down",
+    [ENETUNREACH] = "Network is unreachable",
+    [ENETRESET] = "Network dropped connection on reset",
+    [ECONNABORTED] = "Software caused connection abort",
+    [ECONNRESET] = "Connection reset by peer",
+    [ENOBUFS] = "No buffer space available",
+    [EISCONN] = "Transport endpoint is already connected",
+    [ENOTCONN] = "Transport endpoint is not connected",
+    [ESHUTDOWN] = "Cannot send after transport endpoint shutdown",
+    [ETOOMANYREFS] = "Too many references: cannot splice",
+    [ETIMEDOUT] = "Connection timed out",
+    [ECONNREFUSED] = "Connection refused",
+    [EHOSTDOWN] = "Host is down",
+    [EHOSTUNREACH] = "No route to host",
+    [EALREADY] = "Operation already in progress",
+    [EINPROGRESS] = "Operation now in progress",
+    [ESTALE] = "Stale file handle",
+    [EUCLEAN] = "Structure needs cleaning",
+    [ENOTNAM] = "Not a XENIX named type file",
+    [ENAVAIL] = "No XENIX semaphores available",
+    [EISNAM] = "Is a named type file",
+    [EREMOTEIO] = "Remote I/O error",
+    [EDQUOT] = "Disk quota exceeded",
+    [ENOMEDIUM] = "No medium found",
+    [EMEDIUMTYPE] = "Wrong medium type",
+    [ECANCELED] = "Operation canceled",
+    [ENOKEY] = "Required key not available",
+    [EKEYEXPIRED] = "Key has expired",
+    [EKEYREVOKED] = "Key has been revoked",
+    [EKEYREJECTED] = "Key was rejected by service",
+    [EOWNERDEAD] = "Owner died",
+    [ENOTRECOVERABLE] = "State not recoverable",
+    [ERFKILL] = "Operation not possible due to RF-kill",
+};
+
+ErrnoClass classify_errno(ErrorOp op, int err) {
+    ErrnoClass result = { UNKNOWN_ERROR, SEVERITY_ERROR, 0 };
+    if (err <= 0 || err >= ERRNO_TABLE_SIZE) {
+        return result;
+    }
+    uint8_t entry = 0;
+    if ((unsigned)op < ERROR_OP_COUNT) {
+        entry = classify_table[op][err];
+    }
+    if (entry == 0) {
+        entry = classify_table[ERROR_OP_OTHER][err];
+    }
+    if (entry != 0) {
+        result.type = (ErrorType)((entry & 0x0f) - 1);
+        result.severity = (ErrorSeverity)((entry >> 4) & 0x07);
+        result.retryable = entry >> 7;
+    }
+    return result;
+}
+
+const char *errno_description(int err) {
+    if (err >= 0 && err < ERRNO_TABLE_SIZE && errno_text[err] != NULL) {
+        return errno_text[err];
+    }
+    return "Unknown error";
+}
@@ -0,0 +1,20 @@
+// File: src/errno_classify.h
+#ifndef ERRNO_CLASSIFY_H
+#define ERRNO_CLASSIFY_H
+
+#include "error_handler.h"
+
+typedef struct {
+    ErrorType type;
+    ErrorSeverity severity;
+    int retryable;
+} ErrnoClass;
+
+// Look up how err should be handled when returned by an operation of kind op.
+// Unlisted errnos fall back to the ERROR_OP_OTHER row, then to UNKNOWN_ERROR.
+ErrnoClass classify_errno(ErrorOp op, int err);
+
+// Static description of err; never allocates and is safe from any thread
+const char *errno_description(int err);
+
+#endif // ERRNO_CLASSIFY_H
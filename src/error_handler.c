@@ -2,68 +2,189 @@
 #include "error_handler.h"
 #include "logger.h"
 #include "recovery.h"
+#include "notifier.h"
+#include "handler_registry.h"
+#include "stack_capture.h"
+#include "flight_recorder.h"
+#include "errno_classify.h"
+#include "error_sites.h"
+#include "system_resources.h"
+#include "pressure_monitor.h"
+#include "emergency_reserve.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
-#include <sys/wait.h>
+#include <pthread.h>
 #include <errno.h>   // Added for ETXTBSY and other errno macros
 #include <fcntl.h>   // Added for LOCK_EX, LOCK_NB, LOCK_UN
 
-void handle_error(ErrorType type, const char *message, int error_code) {
-    // Log the error
-    printf("Error for debugging purpose: %s\n", message);
-    log_error(type, message, error_code);
-
-    pid_t pid = fork();
-    if (pid == 0) {
-        // Child process
-
-        // Prepare arguments
-        char type_str[10];
-        char error_code_str[10];
-        snprintf(type_str, sizeof(type_str), "%d", type);
-        snprintf(error_code_str, sizeof(error_code_str), "%d", error_code);
-
-        // Ensure the path to the Python script is correct.
-        // Here, it's assumed that the executable is run from the project root.
-        char *args[] = {
-            "python3",
-            "./dashboard/report_error.py", // Updated path to the Python script
-            type_str,
-            (char *)message,
-            error_code_str,
-            NULL
-        };
-        
-        // Execute the Python script
-        execvp("python3", args);
-        
-        // If execvp returns, an error occurred
-        perror("execvp failed");
-        exit(EXIT_FAILURE);
-    } else if (pid < 0) {
-        // Fork failed
-        perror("fork failed");
-        fprintf(stderr, "Failed to report error using Python script.\n");
-    } else {
-        // Parent process: wait for child if necessary
-        int status;
-        if (waitpid(pid, &status, 0) == -1) {
-            perror("waitpid failed");
-        } else {
-            if (WIFEXITED(status)) {
-                if (WEXITSTATUS(status) != 0) {
-                    fprintf(stderr, "Python script exited with status %d.\n", WEXITSTATUS(status));
-                }
-            } else if (WIFSIGNALED(status)) {
-                fprintf(stderr, "Python script terminated by signal %d.\n", WTERMSIG(status));
-            } else {
-                fprintf(stderr, "Python script did not terminate normally.\n");
-            }
-        }
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+// EH_SITE_() filters on the EH_SEVERITY_OF_<TYPE> numbers, everything else
+// on EH_TYPE_SEVERITY(); a type whose two entries disagree does not build
+#define EH_CHECK_SEVERITY_(type)                                                              \
+    _Static_assert(EH_SEVERITY_OF_##type == EH_TYPE_SEVERITY(type),                           \
+                   "EH_SEVERITY_OF_" #type " differs from EH_TYPE_SEVERITY()")
+EH_CHECK_SEVERITY_(MEMORY_ERROR);
+EH_CHECK_SEVERITY_(FILE_ACCESS_ERROR);
+EH_CHECK_SEVERITY_(INVALID_ARGUMENT);
+EH_CHECK_SEVERITY_(BAD_FILE_DESCRIPTOR);
+EH_CHECK_SEVERITY_(WRONG_DEVICE_COMMAND);
+EH_CHECK_SEVERITY_(DEVICE_ERROR);
+EH_CHECK_SEVERITY_(NULL_ERROR);
+EH_CHECK_SEVERITY_(UNKNOWN_ERROR);
+EH_CHECK_SEVERITY_(TXT_BUSY);
+EH_CHECK_SEVERITY_(DEVICE_ERROR_ACCESS_FAILURE);
+EH_CHECK_SEVERITY_(DEVICE_BUSY);
+_Static_assert(ERROR_TYPE_COUNT == 11, "check the new type's EH_SEVERITY_OF_ entry above");
+
+static RecoveryStatus log_handler(const ErrorEvent *event, void *user_data) {
+    (void)user_data;
+    log_error_event(event);
+    return RECOVERY_SUCCESS;
+}
+
+static RecoveryStatus notify_handler(const ErrorEvent *event, void *user_data) {
+    (void)user_data;
+    // Queue an email report; delivery happens on the notifier thread
+    return notify_error(event->type, event->message, event->error_code) == 0 ? RECOVERY_SUCCESS
+                                                                            : RECOVERY_FAILED;
+}
+
+static void install_default_handlers(void) {
+    for (int type = 0; type < ERROR_TYPE_COUNT; type++) {
+        register_error_handler((ErrorType)type, HANDLER_STAGE_LOG, log_handler, NULL);
+        register_error_handler((ErrorType)type, HANDLER_STAGE_NOTIFY, notify_handler, NULL);
+    }
+    register_builtin_recoveries();
+    flight_recorder_install_signal_handlers();
+    system_resources_init();
+    emergency_reserve_init();
+    // Reads ERROR_STACK_DEPTH and, if capture is on, this thread's stack bounds
+    stack_capture_depth();
+
+    const char *control = getenv("ERROR_SITES_CONTROL");
+    if (control && control[0]) {
+        error_sites_watch_control(control);
+    }
+
+    const char *pressure = getenv("EH_PRESSURE_MONITOR");
+    if (pressure && pressure[0] && strcmp(pressure, "0") != 0) {
+        pressure_monitor_start();
     }
+}
+
+void error_handler_init(void) {
+    pthread_once(&init_once, install_default_handlers);
+}
+
+ErrorSeverity error_type_severity(ErrorType type) {
+    return EH_TYPE_SEVERITY(type);
+}
+
+static void dispatch_event(const ErrorEvent *event) {
+    error_handler_init();
+
+    if (event->type == MEMORY_ERROR) {
+        // Free the ballast first so logging and recovery can allocate
+        emergency_reserve_release();
+    }
+
+    printf("Error for debugging purpose: %s\n", event->message);
+    run_error_handlers(event, HANDLER_STAGE_LOG, NULL);
+    run_error_handlers(event, HANDLER_STAGE_NOTIFY, NULL);
 
     // Attempt recovery
-    recover_from_error(type);
-}
\ No newline at end of file
+    recover_from_event(event);
+    run_error_handlers(event, HANDLER_STAGE_CUSTOM, NULL);
+}
+
+void (handle_error)(ErrorType type, const char *message, int error_code) {
+    ErrorEvent event = { .type = type, .message = message, .error_code = error_code,
+                         .severity = error_type_severity(type) };
+    ErrorStack stack;
+    // Direct and function-pointer calls bypass the handle_error() macro
+    if (!EH_SEVERITY_ENABLED(event.severity)) {
+        return;
+    }
+    flight_record(type, error_code, __builtin_return_address(0), NULL);
+    if (capture_stack(&stack, 1) > 0) {
+        event.stack = &stack;
+    }
+    dispatch_event(&event);
+}
+
+void handle_resource_error(ErrorType type, const char *resource, const char *message, int error_code) {
+    ErrorEvent event = { .type = type, .message = message, .error_code = error_code,
+                         .resource = resource, .severity = error_type_severity(type) };
+    ErrorStack stack;
+    if (!EH_SEVERITY_ENABLED(event.severity)) {
+        return;
+    }
+    flight_record(type, error_code, __builtin_return_address(0), NULL);
+    if (capture_stack(&stack, 1) > 0) {
+        event.stack = &stack;
+    }
+    dispatch_event(&event);
+}
+
+void handle_error_ctx(ErrorType type, const ErrorContext *context, const char *message, int error_code) {
+    ErrorEvent event = { .type = type, .message = message, .error_code = error_code,
+                         .severity = error_type_severity(type), .context = context };
+    ErrorStack stack;
+    if (!EH_SEVERITY_ENABLED(event.severity)) {
+        return;
+    }
+    if (context) {
+        event.resource = context->path ? context->path : context->device;
+    }
+    flight_record(type, error_code, __builtin_return_address(0), NULL);
+    if (capture_stack(&stack, 1) > 0) {
+        event.stack = &stack;
+    }
+    dispatch_event(&event);
+}
+
+void handle_error_site(ErrorSite *site, const char *message, int error_code) {
+    ErrorEvent event = { .type = site->type, .message = message, .error_code = error_code,
+                         .severity = error_type_severity(site->type), .site = site };
+    ErrorStack stack;
+    if (!__atomic_load_n(&site->enabled, __ATOMIC_RELAXED)) {
+        return;
+    }
+    __atomic_fetch_add(&site->hits, 1, __ATOMIC_RELAXED);
+    flight_record(site->type, error_code, __builtin_return_address(0), site);
+    if (capture_stack(&stack, 1) > 0) {
+        event.stack = &stack;
+    }
+    dispatch_event(&event);
+}
+
+void handle_errno(ErrorOp op, int err, const char *resource) {
+    ErrnoClass cls = classify_errno(op, err);
+    // The class is only known at run time, so apply the build's floor here
+    if (!EH_SEVERITY_ENABLED(cls.severity)) {
+        return;
+    }
+    ErrorContext context = ERROR_CONTEXT_INIT;
+    context.op = op;
+    // Device operations name a device node or lock file, the rest a file
+    if (op == ERROR_OP_DEVICE_OPEN || op == ERROR_OP_IOCTL || op == ERROR_OP_LOCK) {
+        context.device = resource;
+    } else {
+        context.path = resource;
+    }
+    // Retrying cannot fix it (e.g. EACCES); recovery gets one look, no waits
+    if (!cls.retryable) {
+        context.attempt_budget = 1;
+    }
+    ErrorEvent event = { .type = cls.type, .message = errno_description(err), .error_code = err,
+                         .resource = resource, .severity = cls.severity, .retryable = cls.retryable,
+                         .context = &context };
+    ErrorStack stack;
+    flight_record(cls.type, err, __builtin_return_address(0), NULL);
+    if (capture_stack(&stack, 1) > 0) {
+        event.stack = &stack;
+    }
+    dispatch_event(&event);
+}
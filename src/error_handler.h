@@ -23,6 +23,10 @@
 #define LOCK_UN 8
 #endif
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Enum for error types
 typedef enum {
     MEMORY_ERROR,
@@ -35,10 +39,219 @@ typedef enum {
     UNKNOWN_ERROR,
     TXT_BUSY,         // Added TXT_BUSY for text file busy error
     DEVICE_ERROR_ACCESS_FAILURE,
-    DEVICE_BUSY       // Added DEVICE_BUSY for device busy state
+    DEVICE_BUSY,      // Added DEVICE_BUSY for device busy state
+    ERROR_TYPE_COUNT  // Number of error types; not a valid type
 } ErrorType;
 
+// Kind of operation that failed, used to classify its errno
+typedef enum {
+    ERROR_OP_OTHER,        // Generic classification, also the fallback for every other kind
+    ERROR_OP_FILE_OPEN,
+    ERROR_OP_DEVICE_OPEN,
+    ERROR_OP_READ_WRITE,
+    ERROR_OP_IOCTL,
+    ERROR_OP_LOCK,
+    ERROR_OP_EXEC,
+    ERROR_OP_ALLOC,
+    ERROR_OP_COUNT
+} ErrorOp;
+
+typedef enum {
+    SEVERITY_DEBUG,
+    SEVERITY_INFO,
+    SEVERITY_WARNING,
+    SEVERITY_ERROR,
+    SEVERITY_CRITICAL
+} ErrorSeverity;
+
+#define ERROR_STACK_MAX_DEPTH 32
+
+// Raw return addresses captured at the error site, symbolized offline
+typedef struct {
+    int depth;
+    void *frames[ERROR_STACK_MAX_DEPTH];
+} ErrorStack;
+
+// Static descriptor for one EH_ERROR()/EH_LOG() call site. The linker gathers
+// all of them into the eh_error_sites section, see error_sites.h.
+typedef struct {
+    const char *file;
+    const char *function;
+    int line;
+    ErrorType type;
+    unsigned long hits;        // Updated with relaxed atomics
+    int enabled;               // See error_site_set_enabled()
+} ErrorSite;
+
+// The failing operation, so recovery acts on the resource that actually
+// failed. Start from ERROR_CONTEXT_INIT and set what is known.
+typedef struct {
+    const char *path;          // File involved, or NULL
+    int fd;                    // Descriptor involved, or -1; used to find the path when path is NULL
+    const char *device;        // Device node or lock file involved, or NULL
+    ErrorOp op;
+    int attempt_budget;        // Most recovery attempts to make; 0 = the type's retry policy, 1 = no waiting
+    unsigned long long deadline_ns;   // CLOCK_MONOTONIC time recovery must finish by; 0 = none
+    struct CancelToken *cancel;       // Stops recovery early when cancelled, or NULL (see cancel.h)
+} ErrorContext;
+
+#define ERROR_CONTEXT_INIT { NULL, -1, NULL, ERROR_OP_OTHER, 0, 0, NULL }
+
+// Everything known about one error occurrence, passed to registered handlers
+typedef struct {
+    ErrorType type;
+    const char *message;
+    int error_code;
+    const ErrorStack *stack;   // NULL when stack capture is disabled
+    const char *resource;      // Path or name of the resource involved, or NULL
+    ErrorSeverity severity;
+    int retryable;             // Non-zero if retrying the operation may succeed
+    const ErrorSite *site;     // Set when raised through EH_ERROR()
+    const ErrorContext *context;   // Set by handle_error_ctx() and handle_errno(), else NULL
+} ErrorEvent;
+
+// Install the default log, notify and recovery handlers. Called lazily by
+// handle_error(); call it explicitly to register custom handlers after the defaults.
+void error_handler_init(void);
+
 // Function to handle errors
 void handle_error(ErrorType type, const char *message, int error_code);
 
+// handle_error() for a problem with a named resource (file, device, ...),
+// which the recovery handlers act on
+void handle_resource_error(ErrorType type, const char *resource, const char *message, int error_code);
+
+// handle_error() with the context of the failing operation, which recovery
+// acts on instead of a default resource
+void handle_error_ctx(ErrorType type, const ErrorContext *context, const char *message, int error_code);
+
+// Classify err for the kind of operation that failed and handle it. The
+// message comes from a static table, so no strerror() call is needed.
+// resource (optional) names the file or device involved.
+void handle_errno(ErrorOp op, int err, const char *resource);
+
+// Default severity of each error type. A macro so that it folds to a
+// constant for the compile-time filter below.
+#define EH_TYPE_SEVERITY(type)                                                                \
+    ((type) == MEMORY_ERROR || (type) == NULL_ERROR ? SEVERITY_CRITICAL :                     \
+     (type) == TXT_BUSY || (type) == DEVICE_BUSY ||                                           \
+     (type) == WRONG_DEVICE_COMMAND ? SEVERITY_WARNING : SEVERITY_ERROR)
+
+ErrorSeverity error_type_severity(ErrorType type);
+
+// Errors below this severity are compiled out of handle_error(), log_error(),
+// EH_ERROR() and EH_LOG() calls with a constant type, and their message
+// arguments are never evaluated. Set it with `make MIN_SEVERITY=<0-4>`
+// (SEVERITY_DEBUG to SEVERITY_CRITICAL).
+#ifndef EH_MIN_SEVERITY
+#define EH_MIN_SEVERITY 0
+#endif
+#define EH_SEVERITY_ENABLED(severity) ((int)(severity) >= EH_MIN_SEVERITY)
+
+// EH_TYPE_SEVERITY() as preprocessor numbers, so EH_SITE_() can pick its
+// expansion before the compiler sees it. error_handler.c asserts that the
+// two agree.
+#define EH_SEVERITY_OF_MEMORY_ERROR 4
+#define EH_SEVERITY_OF_NULL_ERROR 4
+#define EH_SEVERITY_OF_TXT_BUSY 2
+#define EH_SEVERITY_OF_DEVICE_BUSY 2
+#define EH_SEVERITY_OF_WRONG_DEVICE_COMMAND 2
+#define EH_SEVERITY_OF_FILE_ACCESS_ERROR 3
+#define EH_SEVERITY_OF_INVALID_ARGUMENT 3
+#define EH_SEVERITY_OF_BAD_FILE_DESCRIPTOR 3
+#define EH_SEVERITY_OF_DEVICE_ERROR 3
+#define EH_SEVERITY_OF_UNKNOWN_ERROR 3
+#define EH_SEVERITY_OF_DEVICE_ERROR_ACCESS_FAILURE 3
+
+// 1 for each severity level at or above EH_MIN_SEVERITY, else 0
+#define EH_LEVEL_KEPT_0 1
+#if EH_MIN_SEVERITY <= 1
+#define EH_LEVEL_KEPT_1 1
+#else
+#define EH_LEVEL_KEPT_1 0
+#endif
+#if EH_MIN_SEVERITY <= 2
+#define EH_LEVEL_KEPT_2 1
+#else
+#define EH_LEVEL_KEPT_2 0
+#endif
+#if EH_MIN_SEVERITY <= 3
+#define EH_LEVEL_KEPT_3 1
+#else
+#define EH_LEVEL_KEPT_3 0
+#endif
+#if EH_MIN_SEVERITY <= 4
+#define EH_LEVEL_KEPT_4 1
+#else
+#define EH_LEVEL_KEPT_4 0
+#endif
+
+#define EH_CAT_(a, b) a##b
+#define EH_CAT(a, b) EH_CAT_(a, b)
+
+#if EH_MIN_SEVERITY > 0
+#define handle_error(type, message, error_code)                                               \
+    do {                                                                                      \
+        ErrorType eh_type_ = (type);                                                          \
+        if (EH_SEVERITY_ENABLED(EH_TYPE_SEVERITY(eh_type_)))                                  \
+            (handle_error)(eh_type_, (message), (error_code));                                \
+    } while (0)
+#endif
+
+// Like handle_error() and log_error(), for sites declared by EH_ERROR() and EH_LOG()
+void handle_error_site(ErrorSite *site, const char *message, int error_code);
+void log_error_site(ErrorSite *site, const char *message, int error_code);
+
+// Branch to label while the site is enabled. On x86-64 this is a 5-byte jmp
+// that error_site_set_enabled() rewrites into a 5-byte nop, so a disabled
+// site costs one nop and no load. The eh_jump_table entry tells the patcher
+// where the jmp is. Elsewhere, or with -DEH_NO_JUMP_LABELS, it tests the flag.
+#if defined(__x86_64__) && !defined(EH_NO_JUMP_LABELS)
+#define EH_JUMP_LABELS 1
+#define EH_SITE_BRANCH_(site, label)                                                          \
+    asm goto("1: .byte 0xe9\n\t.long %l[" #label "] - (1b + 5)\n\t"                           \
+             ".pushsection eh_jump_table, \"aw\"\n\t.balign 8\n\t"                            \
+             ".quad 1b, %l[" #label "], %c0\n\t.popsection"                                   \
+             : : "i"(&(site)) : : label)
+#else
+#define EH_SITE_BRANCH_(site, label)                                                          \
+    do {                                                                                      \
+        if (__builtin_expect(__atomic_load_n(&(site).enabled, __ATOMIC_RELAXED), 1))          \
+            goto label;                                                                       \
+    } while (0)
+#endif
+
+// Each expansion places one ErrorSite in a dedicated section, so every site
+// can be enumerated with its hit count without any registration at startup.
+// Sites below EH_MIN_SEVERITY are dropped by the preprocessor: no call and
+// no descriptor. type must therefore be an ErrorType name, not an expression.
+#define EH_SITE_(type, call)                                                                  \
+    EH_CAT(EH_SITE_KEPT_, EH_CAT(EH_LEVEL_KEPT_, EH_SEVERITY_OF_##type))(type, call)
+
+#define EH_SITE_KEPT_0(type, call) do { } while (0)
+
+#define EH_SITE_KEPT_1(type, call)                                                            \
+    do {                                                                                      \
+        __label__ eh_site_enabled_;                                                           \
+        static ErrorSite eh_site_                                                             \
+            __attribute__((section("eh_error_sites"), aligned(8))) =                          \
+            { __FILE__, __func__, __LINE__, (type), 0, 1 };                                   \
+        EH_SITE_BRANCH_(eh_site_, eh_site_enabled_);                                          \
+        break;                                                                                \
+    eh_site_enabled_:                                                                         \
+        call;                                                                                 \
+    } while (0)
+
+// Report an error and record where it came from
+#define EH_ERROR(type, message, error_code)                                                   \
+    EH_SITE_(type, handle_error_site(&eh_site_, (message), (error_code)))
+
+// Log an error without handling it, and record where it came from
+#define EH_LOG(type, message, error_code)                                                     \
+    EH_SITE_(type, log_error_site(&eh_site_, (message), (error_code)))
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // ERROR_HANDLER_H
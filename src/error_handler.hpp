@@ -0,0 +1,178 @@
+// File: src/error_handler.hpp
+#ifndef ERROR_HANDLER_HPP
+#define ERROR_HANDLER_HPP
+
+#include "error_handler.h"
+#include <cerrno>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 202002L
+#define EH_UNLIKELY [[unlikely]]
+#else
+#define EH_UNLIKELY
+#endif
+
+// Evaluate a Result-returning expression; on failure return its error from
+// the enclosing function, otherwise yield the value. Uses a GNU statement expression.
+#define EH_TRY(expr)                                              \
+    ({                                                            \
+        auto &&eh_try_result_ = (expr);                           \
+        if (!eh_try_result_) EH_UNLIKELY {                        \
+            return eh_try_result_.error();                        \
+        }                                                         \
+        std::move(eh_try_result_).value();                        \
+    })
+
+namespace eh {
+
+struct Error {
+    ErrorType type;
+    int code;
+    const char *message;    // nullptr for errno errors; the library supplies the text
+    const char *resource;
+    ErrorOp op;
+    bool from_errno;
+};
+
+inline Error make_error(ErrorType type, const char *message, int code = 0) noexcept {
+    return Error{type, code, message, nullptr, ERROR_OP_OTHER, false};
+}
+
+inline Error errno_error(ErrorOp op, int err, const char *resource = nullptr) noexcept {
+    return Error{UNKNOWN_ERROR, err, nullptr, resource, op, true};
+}
+
+// Hand an error to the C library. Kept out of line and marked cold so the
+// failure path adds nothing but a branch to its callers.
+[[gnu::cold, gnu::noinline]] inline void report(const Error &error) noexcept {
+    if (error.from_errno) {
+        handle_errno(error.op, error.code, error.resource);
+    } else {
+        handle_error(error.type, error.message, error.code);
+    }
+}
+
+template <typename T>
+class [[nodiscard]] Result {
+public:
+    Result(const T &value) noexcept(std::is_nothrow_copy_constructible<T>::value) : ok_(true) {
+        ::new (&value_) T(value);
+    }
+    Result(T &&value) noexcept(std::is_nothrow_move_constructible<T>::value) : ok_(true) {
+        ::new (&value_) T(std::move(value));
+    }
+    Result(const Error &error) noexcept : ok_(false), error_(error) {}
+
+    Result(const Result &other) : ok_(other.ok_) {
+        if (ok_) {
+            ::new (&value_) T(other.value_);
+        } else {
+            error_ = other.error_;
+        }
+    }
+    Result(Result &&other) noexcept(std::is_nothrow_move_constructible<T>::value) : ok_(other.ok_) {
+        if (ok_) {
+            ::new (&value_) T(std::move(other.value_));
+        } else {
+            error_ = other.error_;
+        }
+    }
+    Result &operator=(const Result &other) {
+        if (this != &other) {
+            this->~Result();
+            ::new (this) Result(other);
+        }
+        return *this;
+    }
+    Result &operator=(Result &&other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+        if (this != &other) {
+            this->~Result();
+            ::new (this) Result(std::move(other));
+        }
+        return *this;
+    }
+    ~Result() {
+        if (ok_) {
+            value_.~T();
+        }
+    }
+
+    explicit operator bool() const noexcept { return ok_; }
+    bool has_value() const noexcept { return ok_; }
+
+    T &value() & noexcept { return value_; }
+    const T &value() const & noexcept { return value_; }
+    T &&value() && noexcept { return std::move(value_); }
+    const Error &error() const noexcept { return error_; }
+
+    template <typename U>
+    T value_or(U &&fallback) const & {
+        return ok_ ? value_ : static_cast<T>(std::forward<U>(fallback));
+    }
+
+    // Report a failure through handle_error()/handle_errno() and use fallback instead
+    template <typename U>
+    T value_or_report(U &&fallback) && {
+        if (!ok_) EH_UNLIKELY {
+            report(error_);
+            return static_cast<T>(std::forward<U>(fallback));
+        }
+        return std::move(value_);
+    }
+
+private:
+    bool ok_;
+    union {
+        T value_;
+        Error error_;
+    };
+};
+
+template <>
+class [[nodiscard]] Result<void> {
+public:
+    Result() noexcept : ok_(true), error_() {}
+    Result(const Error &error) noexcept : ok_(false), error_(error) {}
+
+    explicit operator bool() const noexcept { return ok_; }
+    bool has_value() const noexcept { return ok_; }
+    void value() const noexcept {}
+    const Error &error() const noexcept { return error_; }
+
+    // Report a failure through handle_error()/handle_errno(); returns true on success
+    bool report_if_error() const noexcept {
+        if (!ok_) EH_UNLIKELY {
+            report(error_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool ok_;
+    Error error_;
+};
+
+// Wrap a POSIX-style return value, where -1 means failure with errno set
+template <typename T>
+inline Result<T> check_errno(T rc, ErrorOp op, const char *resource = nullptr) noexcept {
+    if (rc == static_cast<T>(-1)) EH_UNLIKELY {
+        return errno_error(op, errno, resource);
+    }
+    return rc;
+}
+
+// Wrap a pointer-returning call, where nullptr means failure with errno set
+template <typename T>
+inline Result<T *> check_ptr(T *ptr, ErrorOp op, const char *resource = nullptr) noexcept {
+    if (ptr == nullptr) EH_UNLIKELY {
+        return errno_error(op, errno, resource);
+    }
+    return ptr;
+}
+
+} // namespace eh
+
+#endif // ERROR_HANDLER_HPP
@@ -0,0 +1,345 @@
+// File: src/error_sites.c
+#define _GNU_SOURCE
+#include "error_sites.h"
+#include "logger.h"
+#include "resource_registry.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <libgen.h>
+#include <ucontext.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#include <linux/membarrier.h>
+
+// Emitted next to every x86-64 site branch by EH_SITE_BRANCH_()
+typedef struct {
+    uintptr_t code;
+    uintptr_t target;
+    ErrorSite *site;
+} ErrorJumpEntry;
+
+// Provided by the linker for any section whose name is a C identifier.
+// Weak, so a binary without a single site still links.
+extern ErrorSite __start_eh_error_sites[] __attribute__((weak));
+extern ErrorSite __stop_eh_error_sites[] __attribute__((weak));
+extern ErrorJumpEntry __start_eh_jump_table[] __attribute__((weak));
+extern ErrorJumpEntry __stop_eh_jump_table[] __attribute__((weak));
+
+static pthread_mutex_t patch_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+size_t error_sites_foreach(ErrorSiteVisitor visit, void *user_data) {
+    size_t count = 0;
+    if (__start_eh_error_sites == NULL || __stop_eh_error_sites == NULL) {
+        return 0;
+    }
+    for (ErrorSite *site = __start_eh_error_sites; site < __stop_eh_error_sites; site++) {
+        visit(site, __atomic_load_n(&site->hits, __ATOMIC_RELAXED), user_data);
+        count++;
+    }
+    return count;
+}
+
+static void report_site(const ErrorSite *site, unsigned long hits, void *user_data) {
+    if (hits > 0) {
+        fprintf((FILE *)user_data, "%10lu  %-28s %s:%d (%s)%s\n", hits, error_type_to_string(site->type),
+                site->file, site->line, site->function,
+                __atomic_load_n(&site->enabled, __ATOMIC_RELAXED) ? "" : " [disabled]");
+    }
+}
+
+void error_sites_report(FILE *out) {
+    fprintf(out, "%10s  %-28s %s\n", "HITS", "TYPE", "SITE");
+    error_sites_foreach(report_site, out);
+}
+
+#ifdef EH_JUMP_LABELS
+static pid_t patch_pid;
+static int text_fd = -1;   // /proc/self/mem: text is written through it, never remapped writable
+static int trap_installed;
+static struct sigaction previous_trap;
+
+// A thread that reaches a site while its first byte is an int3 lands here;
+// send it where the site's current state says, as text_poke_bp() does
+static void jump_trap_handler(int sig, siginfo_t *info, void *context) {
+    ucontext_t *uc = context;
+    uintptr_t code = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP] - 1;
+    for (ErrorJumpEntry *entry = __start_eh_jump_table; entry < __stop_eh_jump_table; entry++) {
+        if (entry->code == code) {
+            int enabled = __atomic_load_n(&entry->site->enabled, __ATOMIC_RELAXED);
+            uc->uc_mcontext.gregs[REG_RIP] = (greg_t)(enabled ? entry->target : entry->code + 5);
+            return;
+        }
+    }
+    // Not a site: behave as if this handler had never been installed
+    if (previous_trap.sa_flags & SA_SIGINFO) {
+        previous_trap.sa_sigaction(sig, info, context);
+    } else if (previous_trap.sa_handler == SIG_DFL) {
+        struct sigaction fallback = { .sa_handler = SIG_DFL };
+        sigaction(SIGTRAP, &fallback, NULL);
+        raise(SIGTRAP);
+    } else if (previous_trap.sa_handler != SIG_IGN) {
+        previous_trap.sa_handler(sig);
+    }
+}
+
+static void sync_cores(void) {
+    syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE, 0, 0);
+}
+
+// Set up patching for this process; redone after fork(), since the
+// descriptor and the membarrier registration belong to the parent
+static int prepare_patching(void) {
+    if (patch_pid == getpid()) {
+        return text_fd == -1 ? -1 : 0;
+    }
+    patch_pid = getpid();
+    if (text_fd != -1) {
+        unprotect_fd(text_fd);
+        close(text_fd);
+        text_fd = -1;
+    }
+    // Without a core-serialising barrier another CPU could run a half-written jump
+    if (syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_SYNC_CORE, 0, 0) != 0) {
+        return -1;
+    }
+    if (!trap_installed) {
+        struct sigaction action = { .sa_sigaction = jump_trap_handler,
+                                    .sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK };
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGTRAP, &action, &previous_trap) != 0) {
+            return -1;
+        }
+        trap_installed = 1;
+    }
+    text_fd = open("/proc/self/mem", O_RDWR | O_CLOEXEC);
+    protect_fd(text_fd);
+    return text_fd == -1 ? -1 : 0;
+}
+
+static int poke_text(uintptr_t addr, const unsigned char *bytes, size_t len) {
+    if (pwrite(text_fd, bytes, len, (off_t)addr) != (ssize_t)len) {
+        return -1;
+    }
+    __builtin___clear_cache((char *)addr, (char *)addr + len);
+    return 0;
+}
+
+// Rewrite the 5-byte jmp/nop at entry->code while other threads may be
+// running it: an int3 goes in first, then the last four bytes, then the
+// first byte, with every CPU serialised after each step. No CPU can decode
+// a half-written instruction; jump_trap_handler() covers the int3.
+static int patch_jump(const ErrorJumpEntry *entry, int enabled) {
+    static const unsigned char nop5[5] = { 0x0f, 0x1f, 0x44, 0x00, 0x00 };
+    static const unsigned char int3 = 0xcc;
+    unsigned char insn[5];
+    if (enabled) {
+        int32_t rel = (int32_t)(entry->target - (entry->code + 5));
+        insn[0] = 0xe9;
+        memcpy(insn + 1, &rel, sizeof(rel));
+    } else {
+        memcpy(insn, nop5, sizeof(insn));
+    }
+    if (memcmp((const void *)entry->code, insn, sizeof(insn)) == 0) {
+        return 0;
+    }
+    if (poke_text(entry->code, &int3, 1) != 0) {
+        return -1;
+    }
+    sync_cores();
+    // A failure past this point leaves the int3, which the trap handler
+    // resolves from the site's flag
+    if (poke_text(entry->code + 1, insn + 1, 4) != 0) {
+        return -1;
+    }
+    sync_cores();
+    if (poke_text(entry->code, insn, 1) != 0) {
+        return -1;
+    }
+    sync_cores();
+    return 0;
+}
+#endif
+
+int error_site_set_enabled(ErrorSite *site, int enabled) {
+    int rc = 0;
+    enabled = enabled != 0;
+
+    pthread_mutex_lock(&patch_mutex);
+    // The flag is authoritative: the handlers drop events from a disabled
+    // site even if its branch could not be patched
+    __atomic_store_n(&site->enabled, enabled, __ATOMIC_RELAXED);
+#ifdef EH_JUMP_LABELS
+    if (__start_eh_jump_table != NULL && __stop_eh_jump_table != NULL) {
+        for (ErrorJumpEntry *entry = __start_eh_jump_table; entry < __stop_eh_jump_table; entry++) {
+            if (entry->site == site && (prepare_patching() != 0 || patch_jump(entry, enabled) != 0)) {
+                rc = -1;
+            }
+        }
+    }
+#endif
+    pthread_mutex_unlock(&patch_mutex);
+    return rc;
+}
+
+static int file_matches(const char *site_file, const char *pattern) {
+    size_t site_len = strlen(site_file);
+    size_t pattern_len = strlen(pattern);
+    if (pattern_len > site_len || strcmp(site_file + site_len - pattern_len, pattern) != 0) {
+        return 0;
+    }
+    return pattern_len == site_len || site_file[site_len - pattern_len - 1] == '/' || pattern[0] == '/';
+}
+
+static int site_matches(const ErrorSite *site, const char *file, int line) {
+    return (line == 0 || site->line == line) && file_matches(site->file, file);
+}
+
+int error_sites_set_enabled(const char *file, int line, int enabled) {
+    int matched = 0;
+    if (__start_eh_error_sites == NULL || __stop_eh_error_sites == NULL) {
+        return 0;
+    }
+    for (ErrorSite *site = __start_eh_error_sites; site < __stop_eh_error_sites; site++) {
+        if (site_matches(site, file, line)) {
+            if (__atomic_load_n(&site->enabled, __ATOMIC_RELAXED) != (enabled != 0)) {
+                error_site_set_enabled(site, enabled);
+            }
+            matched++;
+        }
+    }
+    return matched;
+}
+
+int error_sites_load_control(const char *path) {
+    size_t count = 0;
+    if (__start_eh_error_sites != NULL && __stop_eh_error_sites != NULL) {
+        count = (size_t)(__stop_eh_error_sites - __start_eh_error_sites);
+    }
+    // The state the file asks for, starting from everything enabled. Sites
+    // are only touched once it is complete, so a site that stays silenced
+    // across a reload never fires in between.
+    unsigned char *wanted = malloc(count > 0 ? count : 1);
+    if (wanted == NULL) {
+        return -1;
+    }
+    memset(wanted, 1, count);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        free(wanted);
+        return -1;
+    }
+
+    char line[512];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), file)) {
+        char action[16];
+        char target[PATH_MAX];
+        line_no++;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        int fields = sscanf(line, "%15s %4095s", action, target);
+        if (fields <= 0) {
+            continue;
+        }
+        int enabled = strcmp(action, "enable") == 0;
+        if (fields != 2 || (!enabled && strcmp(action, "disable") != 0)) {
+            fprintf(stderr, "%s:%d: expected \"enable|disable <file>[:<line>]\"\n", path, line_no);
+            continue;
+        }
+        int site_line = 0;
+        char *colon = strrchr(target, ':');
+        if (colon && colon[1] != '\0' && strspn(colon + 1, "0123456789") == strlen(colon + 1)) {
+            site_line = atoi(colon + 1);
+            *colon = '\0';
+        }
+        int matched = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (site_matches(&__start_eh_error_sites[i], target, site_line)) {
+                wanted[i] = (unsigned char)enabled;
+                matched++;
+            }
+        }
+        if (matched == 0) {
+            fprintf(stderr, "%s:%d: no error site matches %s\n", path, line_no, target);
+        }
+    }
+    fclose(file);
+
+    for (size_t i = 0; i < count; i++) {
+        ErrorSite *site = &__start_eh_error_sites[i];
+        if (__atomic_load_n(&site->enabled, __ATOMIC_RELAXED) != wanted[i]) {
+            error_site_set_enabled(site, wanted[i]);
+        }
+    }
+    free(wanted);
+    return 0;
+}
+
+static void *watch_control_main(void *arg) {
+    char *path = arg;
+    char dir_buf[PATH_MAX];
+    char name_buf[PATH_MAX];
+    snprintf(dir_buf, sizeof(dir_buf), "%s", path);
+    snprintf(name_buf, sizeof(name_buf), "%s", path);
+    const char *dir = dirname(dir_buf);
+    const char *name = basename(name_buf);
+
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd != -1) {
+        protect_fd(fd);
+    }
+    if (fd == -1 || inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1) {
+        fprintf(stderr, "Cannot watch error site control file %s\n", path);
+        if (fd != -1) {
+            unprotect_fd(fd);
+            close(fd);
+        }
+        free(path);
+        return NULL;
+    }
+
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if (len <= 0) {
+            break;
+        }
+        int reload = 0;
+        for (char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            if (event->len > 0 && strcmp(event->name, name) == 0) {
+                reload = 1;
+            }
+        }
+        if (reload) {
+            error_sites_load_control(path);
+        }
+    }
+    unprotect_fd(fd);
+    close(fd);
+    free(path);
+    return NULL;
+}
+
+int error_sites_watch_control(const char *path) {
+    pthread_t thread;
+    char *copy = strdup(path);
+    if (copy == NULL) {
+        return -1;
+    }
+    error_sites_load_control(path);
+    if (pthread_create(&thread, NULL, watch_control_main, copy) != 0) {
+        free(copy);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
@@ -0,0 +1,37 @@
+// File: src/error_sites.h
+#ifndef ERROR_SITES_H
+#define ERROR_SITES_H
+
+#include "error_handler.h"
+#include <stdio.h>
+#include <stddef.h>
+
+typedef void (*ErrorSiteVisitor)(const ErrorSite *site, unsigned long hits, void *user_data);
+
+// Visit every EH_ERROR()/EH_LOG() site linked into the binary, whether or
+// not it has fired. Returns the number of sites.
+size_t error_sites_foreach(ErrorSiteVisitor visit, void *user_data);
+
+// Print one line per site that has fired: hits, type, file:line and function
+void error_sites_report(FILE *out);
+
+// Enable or silence one site. On x86-64 its jump is rewritten into a nop, so
+// a disabled site costs one nop. Returns -1 if the code could not be
+// rewritten; the site is still silenced then, through its flag.
+int error_site_set_enabled(ErrorSite *site, int enabled);
+
+// Enable or silence every site in file (matched as a path suffix) at line,
+// or at any line when line is 0. Returns the number of sites matched.
+int error_sites_set_enabled(const char *file, int line, int enabled);
+
+// Apply a control file. Each line is "enable|disable <file>[:<line>]";
+// '#' starts a comment. Sites the file does not mention are re-enabled,
+// so the file always describes the complete set of silenced sites.
+// Returns 0 on success, -1 if the file cannot be read.
+int error_sites_load_control(const char *path);
+
+// Load path now and reload it whenever it is rewritten or replaced.
+// error_handler_init() calls this when ERROR_SITES_CONTROL is set.
+int error_sites_watch_control(const char *path);
+
+#endif // ERROR_SITES_H
@@ -0,0 +1,120 @@
+// File: src/file_watch.c
+#define _GNU_SOURCE
+#include "file_watch.h"
+#include "resource_registry.h"
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/inotify.h>
+
+#define FILE_WATCH_MAX_PATHS 8
+#define FILE_WATCH_EVENTS (IN_CREATE | IN_MOVED_TO | IN_ATTRIB)
+
+static int first_readable(const char *const *paths, int count) {
+    for (int i = 0; i < count; i++) {
+        int fd = open(paths[i], O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+        if (fd != -1) {
+            close(fd);
+            return i;
+        }
+    }
+    return -1;
+}
+
+static long remaining_ms(const struct timespec *deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long ms = (long)(deadline->tv_sec - now.tv_sec) * 1000 + (deadline->tv_nsec - now.tv_nsec) / 1000000;
+    return ms < 0 ? 0 : ms;
+}
+
+int file_watch_wait(const char *const *paths, int count, int timeout_ms, const CancelToken *cancel) {
+    int wds[FILE_WATCH_MAX_PATHS];
+    const char *names[FILE_WATCH_MAX_PATHS];
+    struct timespec deadline;
+
+    if (count <= 0 || count > FILE_WATCH_MAX_PATHS) {
+        errno = EINVAL;
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    if (timeout_ms >= 0) {
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    int fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (fd == -1) {
+        return -1;
+    }
+    protect_fd(fd);
+    for (int i = 0; i < count; i++) {
+        char dir_buf[PATH_MAX];
+        snprintf(dir_buf, sizeof(dir_buf), "%s", paths[i]);
+        // Watching the same directory twice returns the same descriptor
+        wds[i] = inotify_add_watch(fd, dirname(dir_buf), FILE_WATCH_EVENTS | IN_ONLYDIR);
+        if (wds[i] == -1) {
+            int saved = errno;
+            unprotect_fd(fd);
+            close(fd);
+            errno = saved;
+            return -1;
+        }
+        const char *slash = strrchr(paths[i], '/');
+        names[i] = slash ? slash + 1 : paths[i];
+    }
+
+    // The file may have appeared before the watches were in place
+    int found = first_readable(paths, count);
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (found == -1) {
+        // A NULL token gives fd -1, which poll() ignores
+        struct pollfd pfds[2] = { { .fd = fd, .events = POLLIN }, { .fd = cancel_token_fd(cancel), .events = POLLIN } };
+        int wait_ms = timeout_ms < 0 ? -1 : (int)remaining_ms(&deadline);
+        int ready = poll(pfds, 2, wait_ms);
+        if (ready == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            if (ready == 0) {
+                errno = ETIMEDOUT;
+            }
+            break;
+        }
+        if (pfds[1].revents & POLLIN) {
+            errno = ECANCELED;
+            break;
+        }
+
+        ssize_t len = read(fd, buf, sizeof(buf));
+        int relevant = 0;
+        for (char *p = buf; len > 0 && p < buf + len;
+             p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            if (event->mask & IN_Q_OVERFLOW) {
+                relevant = 1;
+            }
+            for (int i = 0; i < count && event->len > 0; i++) {
+                if (event->wd == wds[i] && strcmp(event->name, names[i]) == 0) {
+                    relevant = 1;
+                }
+            }
+        }
+        if (relevant) {
+            found = first_readable(paths, count);
+        }
+    }
+    unprotect_fd(fd);
+    close(fd);
+    return found;
+}
@@ -0,0 +1,17 @@
+// File: src/file_watch.h
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+#include "cancel.h"
+
+// Wait until one of paths can be opened for reading. The parent directories
+// are watched with inotify, so this wakes as soon as a file is created,
+// renamed into place or has its permissions changed, without polling.
+// Earlier paths take priority when several are readable.
+// Returns the index of the readable path; -1 with errno ETIMEDOUT when
+// timeout_ms (-1 = forever) passes first, ECANCELED when cancel (optional)
+// is cancelled, or another errno when the directories cannot be watched
+// (e.g. a parent does not exist).
+int file_watch_wait(const char *const *paths, int count, int timeout_ms, const CancelToken *cancel);
+
+#endif // FILE_WATCH_H
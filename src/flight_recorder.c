@@ -0,0 +1,284 @@
+// File: src/flight_recorder.c
+#define _GNU_SOURCE
+#include "flight_recorder.h"
+#include "emergency_reserve.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+
+// Room for the crash handler after the thread's own stack has overflowed
+#define SIGNAL_STACK_SIZE (64 * 1024)
+
+typedef struct {
+    _Atomic unsigned long seq;   // index + 1 once the slot is fully written
+    uint64_t timestamp_ns;
+    const void *call_site;
+    const ErrorSite *site;
+    int error_code;
+    ErrorType type;
+} FlightEvent;
+
+// Rings are never freed: a dump may walk them from a signal handler at any
+// time. A ring released by an exiting thread is reused by the next new thread.
+typedef struct FlightRing {
+    struct FlightRing *next;
+    atomic_int in_use;
+    pid_t tid;
+    void *signal_stack;   // Alternate signal stack, reused with the ring
+    _Atomic unsigned long head;
+    FlightEvent events[FLIGHT_RECORDER_DEPTH];
+} FlightRing;
+
+static _Atomic(FlightRing *) ring_list;
+static __thread FlightRing *thread_ring;
+static pthread_key_t ring_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static volatile sig_atomic_t dump_fd = STDERR_FILENO;
+
+static const int crash_signals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+#define CRASH_SIGNAL_COUNT (sizeof(crash_signals) / sizeof(crash_signals[0]))
+static struct sigaction previous_actions[CRASH_SIGNAL_COUNT];
+
+static void release_ring(void *arg) {
+    FlightRing *ring = arg;
+    stack_t current;
+    // The next thread to take the ring also takes its signal stack
+    if (ring->signal_stack && sigaltstack(NULL, &current) == 0 && current.ss_sp == ring->signal_stack) {
+        stack_t disable = { .ss_flags = SS_DISABLE };
+        sigaltstack(&disable, NULL);
+    }
+    atomic_store_explicit(&ring->in_use, 0, memory_order_release);
+}
+
+// Give the calling thread an alternate signal stack, unless the application
+// already gave it one, so a stack overflow still produces a crash dump
+static void install_signal_stack(FlightRing *ring) {
+    stack_t current;
+    if (sigaltstack(NULL, &current) != 0 || !(current.ss_flags & SS_DISABLE)) {
+        return;
+    }
+    if (ring->signal_stack == NULL) {
+        void *stack = mmap(NULL, SIGNAL_STACK_SIZE, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+        if (stack == MAP_FAILED) {
+            return;
+        }
+        ring->signal_stack = stack;
+    }
+    stack_t stack = { .ss_sp = ring->signal_stack, .ss_size = SIGNAL_STACK_SIZE, .ss_flags = 0 };
+    sigaltstack(&stack, NULL);
+}
+
+static void create_key(void) {
+    pthread_key_create(&ring_key, release_ring);
+}
+
+static FlightRing *acquire_ring(void) {
+    pthread_once(&key_once, create_key);
+
+    FlightRing *ring;
+    for (ring = atomic_load(&ring_list); ring != NULL; ring = ring->next) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&ring->in_use, &expected, 1)) {
+            break;
+        }
+    }
+    if (ring == NULL) {
+        ring = calloc(1, sizeof(FlightRing));
+        if (ring == NULL) {
+            // Out of memory is exactly when the record matters most
+            ring = emergency_alloc(sizeof(FlightRing));
+        }
+        if (ring == NULL) {
+            return NULL;
+        }
+        atomic_store(&ring->in_use, 1);
+        FlightRing *head = atomic_load(&ring_list);
+        do {
+            ring->next = head;
+        } while (!atomic_compare_exchange_weak(&ring_list, &head, ring));
+    }
+    // A reused ring still holds the previous thread's events; hide them
+    for (int i = 0; i < FLIGHT_RECORDER_DEPTH; i++) {
+        atomic_store_explicit(&ring->events[i].seq, 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+    ring->tid = (pid_t)syscall(SYS_gettid);
+    pthread_setspecific(ring_key, ring);
+    install_signal_stack(ring);
+    return ring;
+}
+
+void flight_record(ErrorType type, int error_code, const void *call_site, const ErrorSite *site) {
+    FlightRing *ring = thread_ring;
+    if (ring == NULL) {
+        ring = thread_ring = acquire_ring();
+        if (ring == NULL) {
+            return;
+        }
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    unsigned long index = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    FlightEvent *event = &ring->events[index % FLIGHT_RECORDER_DEPTH];
+    atomic_store_explicit(&event->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    event->timestamp_ns = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+    event->call_site = call_site;
+    event->site = site;
+    event->error_code = error_code;
+    event->type = type;
+    atomic_store_explicit(&event->seq, index + 1, memory_order_release);
+    atomic_store_explicit(&ring->head, index + 1, memory_order_release);
+}
+
+// Minimal formatting that is safe to use from a signal handler
+typedef struct {
+    char data[256];
+    size_t len;
+} DumpLine;
+
+static void put_str(DumpLine *line, const char *s) {
+    while (*s && line->len < sizeof(line->data)) {
+        line->data[line->len++] = *s++;
+    }
+}
+
+static void put_uint(DumpLine *line, uint64_t value, unsigned base, int min_digits) {
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[n++] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value && n < (int)sizeof(tmp));
+    while (n < min_digits && n < (int)sizeof(tmp)) {
+        tmp[n++] = '0';
+    }
+    while (n > 0 && line->len < sizeof(line->data)) {
+        line->data[line->len++] = tmp[--n];
+    }
+}
+
+static void put_int(DumpLine *line, int value) {
+    if (value < 0) {
+        put_str(line, "-");
+        put_uint(line, (uint64_t)(-(int64_t)value), 10, 1);
+    } else {
+        put_uint(line, (uint64_t)value, 10, 1);
+    }
+}
+
+static void flush_line(int fd, DumpLine *line) {
+    size_t off = 0;
+    while (off < line->len) {
+        ssize_t n = write(fd, line->data + off, line->len - off);
+        if (n <= 0) {
+            break;
+        }
+        off += (size_t)n;
+    }
+    line->len = 0;
+}
+
+void flight_recorder_dump(int fd) {
+    DumpLine line = { .len = 0 };
+    put_str(&line, "=== error flight recorder ===\n");
+    flush_line(fd, &line);
+
+    for (FlightRing *ring = atomic_load(&ring_list); ring != NULL; ring = ring->next) {
+        unsigned long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (head == 0) {
+            continue;
+        }
+        put_str(&line, "thread ");
+        put_uint(&line, (uint64_t)ring->tid, 10, 1);
+        put_str(&line, atomic_load(&ring->in_use) ? "" : " (exited)");
+        put_str(&line, ":\n");
+        flush_line(fd, &line);
+
+        unsigned long first = head > FLIGHT_RECORDER_DEPTH ? head - FLIGHT_RECORDER_DEPTH : 0;
+        for (unsigned long i = first; i < head; i++) {
+            const FlightEvent *event = &ring->events[i % FLIGHT_RECORDER_DEPTH];
+            if (atomic_load_explicit(&event->seq, memory_order_acquire) != i + 1) {
+                continue;   // Being overwritten right now
+            }
+            put_str(&line, "  ");
+            put_uint(&line, event->timestamp_ns / 1000000000ull, 10, 1);
+            put_str(&line, ".");
+            put_uint(&line, event->timestamp_ns % 1000000000ull, 10, 9);
+            put_str(&line, " ");
+            put_str(&line, error_type_to_string(event->type));
+            put_str(&line, " code=");
+            put_int(&line, event->error_code);
+            put_str(&line, " site=0x");
+            put_uint(&line, (uint64_t)(uintptr_t)event->call_site, 16, 1);
+            if (event->site) {
+                put_str(&line, " at ");
+                put_str(&line, event->site->file);
+                put_str(&line, ":");
+                put_int(&line, event->site->line);
+            }
+            put_str(&line, "\n");
+            flush_line(fd, &line);
+        }
+    }
+}
+
+void flight_recorder_set_dump_fd(int fd) {
+    dump_fd = fd;
+}
+
+static void dump_signal_handler(int sig) {
+    (void)sig;
+    int saved_errno = errno;
+    flight_recorder_dump(dump_fd);
+    errno = saved_errno;
+}
+
+static void crash_signal_handler(int sig) {
+    flight_recorder_dump(dump_fd);
+    // Hand the signal back to whatever was installed before us and re-raise it
+    for (size_t i = 0; i < CRASH_SIGNAL_COUNT; i++) {
+        if (crash_signals[i] == sig) {
+            sigaction(sig, &previous_actions[i], NULL);
+        }
+    }
+    raise(sig);
+}
+
+static int install_if_default(int sig, void (*handler)(int), struct sigaction *previous) {
+    struct sigaction current;
+    if (sigaction(sig, NULL, &current) != 0 || current.sa_handler != SIG_DFL) {
+        return 0;
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART | SA_ONSTACK;
+    if (previous) {
+        *previous = current;
+    }
+    return sigaction(sig, &action, NULL) == 0;
+}
+
+void flight_recorder_install_signal_handlers(void) {
+    // Other threads get their signal stack with their first recorded error
+    if (thread_ring == NULL) {
+        thread_ring = acquire_ring();
+    }
+    install_if_default(SIGUSR2, dump_signal_handler, NULL);
+    for (size_t i = 0; i < CRASH_SIGNAL_COUNT; i++) {
+        install_if_default(crash_signals[i], crash_signal_handler, &previous_actions[i]);
+    }
+}
@@ -0,0 +1,27 @@
+// File: src/flight_recorder.h
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include "error_handler.h"
+
+// Events kept per thread; older ones are overwritten
+#define FLIGHT_RECORDER_DEPTH 64
+
+// Append an event to the calling thread's ring. Never locks or does I/O.
+// site is the EH_ERROR() descriptor, or NULL for plain handle_error() calls.
+void flight_record(ErrorType type, int error_code, const void *call_site, const ErrorSite *site);
+
+// Write every thread's recent events to fd, oldest first. Async-signal-safe.
+void flight_recorder_dump(int fd);
+
+// Choose where SIGUSR2 and crash dumps go (default: stderr)
+void flight_recorder_set_dump_fd(int fd);
+
+// Dump on SIGUSR2, and before dying on SIGSEGV, SIGBUS, SIGFPE, SIGILL or
+// SIGABRT. Signals the application already handles are left alone. The
+// handlers run on an alternate signal stack, so a stack overflow is dumped
+// too; the calling thread gets one now, other threads when they first
+// record an error. A thread that never does dies without a dump on overflow.
+void flight_recorder_install_signal_handlers(void);
+
+#endif // FLIGHT_RECORDER_H
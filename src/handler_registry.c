@@ -0,0 +1,151 @@
+// File: src/handler_registry.c
+#include "handler_registry.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+typedef struct {
+    HandlerStage stage;
+    ErrorHandlerFn fn;
+    void *user_data;
+} HandlerEntry;
+
+// Chains are immutable once published. Writers copy, modify and swap the
+// pointer; readers load it once and walk it without locking.
+typedef struct HandlerChain {
+    struct HandlerChain *retired_next;
+    size_t count;
+    HandlerEntry entries[];
+} HandlerChain;
+
+static _Atomic(HandlerChain *) handler_table[ERROR_TYPE_COUNT];
+
+// Serialises writers only
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Replaced chains may still be walked by a reader, so they are parked here
+// instead of freed. Registration is a startup-time operation, so this stays small.
+static HandlerChain *retired_chains;
+
+static HandlerChain *chain_alloc(size_t count) {
+    HandlerChain *chain = malloc(sizeof(HandlerChain) + count * sizeof(HandlerEntry));
+    if (chain) {
+        chain->retired_next = NULL;
+        chain->count = count;
+    }
+    return chain;
+}
+
+static void chain_publish(ErrorType type, HandlerChain *chain) {
+    HandlerChain *old = atomic_exchange_explicit(&handler_table[type], chain, memory_order_acq_rel);
+    if (old) {
+        old->retired_next = retired_chains;
+        retired_chains = old;
+    }
+}
+
+int register_error_handler(ErrorType type, HandlerStage stage, ErrorHandlerFn fn, void *user_data) {
+    if ((unsigned)type >= ERROR_TYPE_COUNT || (unsigned)stage >= HANDLER_STAGE_COUNT || fn == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&registry_mutex);
+    HandlerChain *old = atomic_load_explicit(&handler_table[type], memory_order_relaxed);
+    size_t old_count = old ? old->count : 0;
+    HandlerChain *chain = chain_alloc(old_count + 1);
+    if (chain == NULL) {
+        pthread_mutex_unlock(&registry_mutex);
+        return -1;
+    }
+
+    // Insert after the last entry of the same or an earlier stage
+    size_t pos = 0;
+    while (pos < old_count && old->entries[pos].stage <= stage) {
+        pos++;
+    }
+    if (old_count) {
+        memcpy(chain->entries, old->entries, pos * sizeof(HandlerEntry));
+        memcpy(chain->entries + pos + 1, old->entries + pos, (old_count - pos) * sizeof(HandlerEntry));
+    }
+    chain->entries[pos].stage = stage;
+    chain->entries[pos].fn = fn;
+    chain->entries[pos].user_data = user_data;
+
+    chain_publish(type, chain);
+    pthread_mutex_unlock(&registry_mutex);
+    return 0;
+}
+
+int unregister_error_handler(ErrorType type, ErrorHandlerFn fn, void *user_data) {
+    if ((unsigned)type >= ERROR_TYPE_COUNT) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&registry_mutex);
+    HandlerChain *old = atomic_load_explicit(&handler_table[type], memory_order_relaxed);
+    size_t count = old ? old->count : 0;
+    size_t pos = 0;
+    while (pos < count && (old->entries[pos].fn != fn || old->entries[pos].user_data != user_data)) {
+        pos++;
+    }
+    if (pos == count) {
+        pthread_mutex_unlock(&registry_mutex);
+        return -1;
+    }
+
+    HandlerChain *chain = chain_alloc(count - 1);
+    if (chain == NULL) {
+        pthread_mutex_unlock(&registry_mutex);
+        return -1;
+    }
+    memcpy(chain->entries, old->entries, pos * sizeof(HandlerEntry));
+    memcpy(chain->entries + pos, old->entries + pos + 1, (count - pos - 1) * sizeof(HandlerEntry));
+
+    chain_publish(type, chain);
+    pthread_mutex_unlock(&registry_mutex);
+    return 0;
+}
+
+int count_error_handlers(ErrorType type, HandlerStage stage) {
+    int count = 0;
+    if ((unsigned)type < ERROR_TYPE_COUNT) {
+        const HandlerChain *chain = atomic_load_explicit(&handler_table[type], memory_order_acquire);
+        for (size_t i = 0; chain && i < chain->count; i++) {
+            count += chain->entries[i].stage == stage;
+        }
+    }
+    return count;
+}
+
+RecoveryStatus run_error_handlers(const ErrorEvent *event, HandlerStage stage, int *handlers_run) {
+    RecoveryStatus best = RECOVERY_FAILED;
+    int run = 0;
+
+    if ((unsigned)event->type < ERROR_TYPE_COUNT) {
+        const HandlerChain *chain = atomic_load_explicit(&handler_table[event->type], memory_order_acquire);
+        size_t count = chain ? chain->count : 0;
+        for (size_t i = 0; i < count; i++) {
+            const HandlerEntry *entry = &chain->entries[i];
+            if (entry->stage != stage) {
+                if (entry->stage > stage) {
+                    break;
+                }
+                continue;
+            }
+            RecoveryStatus status = entry->fn(event, entry->user_data);
+            run++;
+            if (status == RECOVERY_SUCCESS || (status == RECOVERY_PARTIAL && best == RECOVERY_FAILED)) {
+                best = status;
+            }
+            if (stage == HANDLER_STAGE_RECOVER && status == RECOVERY_SUCCESS) {
+                break;
+            }
+        }
+    }
+
+    if (handlers_run) {
+        *handlers_run = run;
+    }
+    return best;
+}
@@ -0,0 +1,35 @@
+// File: src/handler_registry.h
+#ifndef HANDLER_REGISTRY_H
+#define HANDLER_REGISTRY_H
+
+#include "error_handler.h"
+#include "recovery.h"
+
+// Stages run in this order for every error
+typedef enum {
+    HANDLER_STAGE_LOG,
+    HANDLER_STAGE_NOTIFY,
+    HANDLER_STAGE_RECOVER,
+    HANDLER_STAGE_CUSTOM,
+    HANDLER_STAGE_COUNT
+} HandlerStage;
+
+typedef RecoveryStatus (*ErrorHandlerFn)(const ErrorEvent *event, void *user_data);
+
+// Append a handler to the chain for type. Handlers of one stage run in
+// registration order. Returns 0 on success, -1 on bad arguments or ENOMEM.
+int register_error_handler(ErrorType type, HandlerStage stage, ErrorHandlerFn fn, void *user_data);
+
+// Remove the first handler matching fn and user_data. Returns 0 if one was removed.
+int unregister_error_handler(ErrorType type, ErrorHandlerFn fn, void *user_data);
+
+// Number of handlers currently registered for type in stage
+int count_error_handlers(ErrorType type, HandlerStage stage);
+
+// Run the handlers of one stage for event without taking any lock.
+// For HANDLER_STAGE_RECOVER, handlers run until one succeeds and the best
+// status is returned; other stages always run every handler.
+// *handlers_run (optional) receives the number of handlers invoked.
+RecoveryStatus run_error_handlers(const ErrorEvent *event, HandlerStage stage, int *handlers_run);
+
+#endif // HANDLER_REGISTRY_H
@@ -0,0 +1,259 @@
+// File: src/lock_wait.c
+#define _GNU_SOURCE
+#include "lock_wait.h"
+#include "resource_registry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+// Sent to the helper thread to break it out of a blocking lock call
+#define LOCK_WAIT_SIGNAL (SIGRTMIN + 4)
+#define INTERRUPT_RETRY_MS 10
+// Interrupts sent before the caller stops waiting for the helper
+#define INTERRUPT_MAX_RETRIES 5
+
+// Shared by the caller and the helper; the last of the two to let go frees it
+typedef struct {
+    LockKind kind;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int refs;
+    int done;
+    int cancelled;      // errno to report once interrupted, or 0
+    int error;
+    char path[];
+} LockWaiter;
+
+static pthread_once_t signal_once = PTHREAD_ONCE_INIT;
+static int signal_ready;
+
+static void interrupt_handler(int sig) {
+    (void)sig;
+}
+
+// Without SA_RESTART the blocked flock()/fcntl() fails with EINTR. An
+// application that already uses the signal keeps it, and waits then fail.
+static void install_interrupt_handler(void) {
+    struct sigaction current;
+    if (sigaction(LOCK_WAIT_SIGNAL, NULL, &current) != 0 || current.sa_handler != SIG_DFL) {
+        return;
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = interrupt_handler;
+    sigemptyset(&action.sa_mask);
+    signal_ready = sigaction(LOCK_WAIT_SIGNAL, &action, NULL) == 0;
+}
+
+int find_lock_holder(const char *path, LockHolder *holder) {
+    struct stat st;
+    char line[256];
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+    FILE *locks = fopen("/proc/locks", "r");
+    if (locks == NULL) {
+        return -1;
+    }
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), locks)) {
+        char kind[16], access[16];
+        int pid;
+        unsigned int dev_major, dev_minor;
+        unsigned long inode;
+        // "1: FLOCK  ADVISORY  WRITE 1234 08:01:5678 0 EOF"; waiters are
+        // listed as "1: -> FLOCK ..." and are skipped by the pattern
+        if (sscanf(line, "%*d: %15s %*s %15s %d %x:%x:%lu", kind, access, &pid, &dev_major, &dev_minor,
+                   &inode) != 6 ||
+            inode != (unsigned long)st.st_ino || makedev(dev_major, dev_minor) != st.st_dev) {
+            continue;
+        }
+        holder->kind = strcmp(kind, "FLOCK") == 0 ? LOCK_KIND_FLOCK :
+                       strcmp(kind, "OFDLCK") == 0 ? LOCK_KIND_OFD : LOCK_KIND_POSIX;
+        holder->pid = pid;
+        holder->exclusive = strcmp(access, "WRITE") == 0;
+        found = 1;
+    }
+    fclose(locks);
+    return found;
+}
+
+static int take_and_release(LockWaiter *waiter, int fd, int writable) {
+    if (waiter->kind == LOCK_KIND_FLOCK) {
+        if (flock(fd, LOCK_EX) != 0) {
+            return -1;
+        }
+        flock(fd, LOCK_UN);
+        return 0;
+    }
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = writable ? F_WRLCK : F_RDLCK;
+    lock.l_whence = SEEK_SET;
+    if (fcntl(fd, F_OFD_SETLKW, &lock) != 0) {
+        return -1;
+    }
+    lock.l_type = F_UNLCK;
+    fcntl(fd, F_OFD_SETLK, &lock);
+    return 0;
+}
+
+// Called with waiter->mutex held; unlocks it
+static void release_waiter(LockWaiter *waiter) {
+    int last = --waiter->refs == 0;
+    pthread_mutex_unlock(&waiter->mutex);
+    if (last) {
+        pthread_cond_destroy(&waiter->cond);
+        pthread_mutex_destroy(&waiter->mutex);
+        free(waiter);
+    }
+}
+
+static void *lock_waiter_main(void *arg) {
+    LockWaiter *waiter = arg;
+    sigset_t interrupt;
+    int writable = 1;
+    // The thread inherits the caller's mask, and server threads often block
+    // every signal; the interrupt must get through regardless
+    sigemptyset(&interrupt);
+    sigaddset(&interrupt, LOCK_WAIT_SIGNAL);
+    pthread_sigmask(SIG_UNBLOCK, &interrupt, NULL);
+
+    int fd = open(waiter->path, O_RDWR | O_CLOEXEC | O_NOCTTY);
+    if (fd == -1) {
+        writable = 0;
+        fd = open(waiter->path, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    }
+
+    int error = 0;
+    if (fd == -1) {
+        error = errno;
+    } else {
+        // Closing it early would drop the lock we are about to take
+        protect_fd(fd);
+        for (;;) {
+            pthread_mutex_lock(&waiter->mutex);
+            int cancelled = waiter->cancelled;
+            pthread_mutex_unlock(&waiter->mutex);
+            if (cancelled) {
+                error = cancelled;
+                break;
+            }
+            if (take_and_release(waiter, fd, writable) == 0) {
+                break;
+            }
+            if (errno != EINTR) {
+                error = errno;
+                break;
+            }
+        }
+        unprotect_fd(fd);
+        close(fd);
+    }
+
+    pthread_mutex_lock(&waiter->mutex);
+    waiter->error = error;
+    waiter->done = 1;
+    pthread_cond_signal(&waiter->cond);
+    release_waiter(waiter);
+    return NULL;
+}
+
+static void add_ms(struct timespec *ts, long ms) {
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+int wait_for_lock(const char *path, LockKind kind, int timeout_ms, CancelToken *cancel) {
+    LockWaiter *waiter;
+    pthread_condattr_t attr;
+    pthread_t thread;
+    struct timespec deadline;
+
+    CancelWatch watch;
+    pthread_once(&signal_once, install_interrupt_handler);
+    if ((timeout_ms >= 0 || cancel != NULL) && !signal_ready) {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    // The helper may outlive this call, so it gets its own copy of path
+    waiter = calloc(1, sizeof(*waiter) + strlen(path) + 1);
+    if (waiter == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    strcpy(waiter->path, path);
+    waiter->kind = kind == LOCK_KIND_NONE ? LOCK_KIND_FLOCK : kind;
+    waiter->refs = 2;
+    pthread_mutex_init(&waiter->mutex, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&waiter->cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    int rc = pthread_create(&thread, NULL, lock_waiter_main, waiter);
+    if (rc != 0) {
+        pthread_cond_destroy(&waiter->cond);
+        pthread_mutex_destroy(&waiter->mutex);
+        free(waiter);
+        errno = rc;
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    add_ms(&deadline, timeout_ms);
+    cancel_token_watch(cancel, &watch, &waiter->mutex, &waiter->cond);
+    pthread_mutex_lock(&waiter->mutex);
+    int reason = ETIMEDOUT;
+    while (!waiter->done) {
+        if (cancel_token_cancelled(cancel)) {
+            reason = ECANCELED;
+            break;
+        }
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&waiter->cond, &waiter->mutex);
+        } else if (pthread_cond_timedwait(&waiter->cond, &waiter->mutex, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    // Past the deadline or cancelled: interrupt the helper a few times, in
+    // case the first signal arrived before it entered the blocking call.
+    // If it still has not noticed, leave it behind rather than overrun.
+    for (int retry = 0; !waiter->done && retry < INTERRUPT_MAX_RETRIES; retry++) {
+        waiter->cancelled = reason;
+        pthread_kill(thread, LOCK_WAIT_SIGNAL);
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        add_ms(&deadline, INTERRUPT_RETRY_MS);
+        pthread_cond_timedwait(&waiter->cond, &waiter->mutex, &deadline);
+    }
+    int done = waiter->done;
+    int error = done ? waiter->error : reason;
+    pthread_mutex_unlock(&waiter->mutex);
+    cancel_token_unwatch(cancel, &watch);
+    if (done) {
+        pthread_join(thread, NULL);
+    } else {
+        pthread_detach(thread);
+    }
+    pthread_mutex_lock(&waiter->mutex);
+    release_waiter(waiter);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+// File: src/lock_wait.h
+#ifndef LOCK_WAIT_H
+#define LOCK_WAIT_H
+
+#include "cancel.h"
+#include <sys/types.h>
+
+typedef enum {
+    LOCK_KIND_NONE,
+    LOCK_KIND_FLOCK,
+    LOCK_KIND_POSIX,
+    LOCK_KIND_OFD
+} LockKind;
+
+typedef struct {
+    LockKind kind;
+    pid_t pid;          // -1 for OFD locks, which belong to no process
+    int exclusive;
+} LockHolder;
+
+// Find a lock held on path by parsing /proc/locks. Returns 1 and fills
+// *holder if one is held, 0 if the file is unlocked, -1 on error.
+int find_lock_holder(const char *path, LockHolder *holder);
+
+// Block until a lock of the given kind could be taken on path, then drop it
+// again: flock() for LOCK_KIND_FLOCK, F_OFD_SETLKW otherwise (which also
+// waits out POSIX locks). The wait runs on a helper thread that is
+// interrupted when timeout_ms (-1 = forever) passes or cancel (optional)
+// is cancelled. Returns 0 once the lock is free, or -1 with errno
+// ETIMEDOUT, ECANCELED or the error that prevented waiting.
+int wait_for_lock(const char *path, LockKind kind, int timeout_ms, CancelToken *cancel);
+
+#endif // LOCK_WAIT_H
@@ -1,6 +1,10 @@
 // File: src/logger.c
 #include "logger.h"
+#include "stack_capture.h"
+#include "resource_registry.h"
 #include <stdio.h>
+#include <stdarg.h>
+#include <unistd.h>
 #include <time.h>
 #include <pthread.h>
 #include <string.h>
@@ -9,15 +13,20 @@
 
 #define LOG_FILE "logs/error_log.log"
 #define MAX_LOG_SIZE 5242880 // 5MB
+#define LOG_LINE_MAX (1024 + ERROR_STACK_MAX_DEPTH * 96)
 
 pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int log_fd = -1;
+static dev_t log_dev;
+static ino_t log_ino;
 
 // Function to get current timestamp
 const char* current_timestamp() {
     static char buffer[20];
     time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    strftime(buffer, sizeof(buffer)-1, "%Y-%m-%d %H:%M:%S", t);
+    struct tm t;
+    localtime_r(&now, &t);
+    strftime(buffer, sizeof(buffer)-1, "%Y-%m-%d %H:%M:%S", &t);
     return buffer;
 }
 
@@ -73,17 +82,101 @@ void ensure_log_directory_exists() {
     }
 }
 
-void log_error(ErrorType type, const char *message, int error_code) {
-    pthread_mutex_lock(&log_mutex);
+// Caller holds log_mutex. The descriptor is kept open between lines and
+// reopened when the file is rotated or replaced.
+static int open_log_file(int *keep) {
+    struct stat st;
+    if (log_fd != -1 && stat(LOG_FILE, &st) == 0 && st.st_dev == log_dev && st.st_ino == log_ino) {
+        *keep = 1;
+        return log_fd;
+    }
+    if (log_fd != -1) {
+        unprotect_fd(log_fd);
+        close(log_fd);
+        log_fd = -1;
+    }
     ensure_log_directory_exists();
+    int fd = open(LOG_FILE, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return -1;
+    }
+    // Keep it only if descriptor cleanup is guaranteed to leave it alone
+    *keep = fstat(fd, &st) == 0 && protect_fd(fd) == 0;
+    if (*keep) {
+        log_fd = fd;
+        log_dev = st.st_dev;
+        log_ino = st.st_ino;
+    }
+    return fd;
+}
+
+static void append(char *line, size_t *len, const char *format, ...) {
+    if (*len >= LOG_LINE_MAX - 1) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line + *len, LOG_LINE_MAX - 1 - *len, format, args);
+    va_end(args);
+    if (n > 0) {
+        *len += (size_t)n < LOG_LINE_MAX - 1 - *len ? (size_t)n : LOG_LINE_MAX - 2 - *len;
+    }
+}
+
+// Formats on the stack and writes with one write() so logging still works
+// when malloc() does not
+static void write_log_line(ErrorType type, const char *message, int error_code,
+                           const char *resource, const ErrorSite *site, const char *stack) {
+    char line[LOG_LINE_MAX];
+    size_t len = 0;
+    int keep = 0;
+
+    pthread_mutex_lock(&log_mutex);
     rotate_logs_if_needed();
-    FILE *file = fopen(LOG_FILE, "a");
-    if (!file) {
+    int fd = open_log_file(&keep);
+    if (fd == -1) {
         pthread_mutex_unlock(&log_mutex);
         return;
     }
 
-    fprintf(file, "[%s] %s: %s (Error Code: %d)\n", current_timestamp(), error_type_to_string(type), message, error_code);
-    fclose(file);
+    append(line, &len, "[%s] %s: %s (Error Code: %d)", current_timestamp(), error_type_to_string(type), message,
+           error_code);
+    if (resource) {
+        append(line, &len, " resource=%s", resource);
+    }
+    if (site) {
+        append(line, &len, " site=%s:%d", site->file, site->line);
+    }
+    if (stack && stack[0]) {
+        append(line, &len, " stack=%s", stack);
+    }
+    line[len++] = '\n';
+    if (write(fd, line, len) < 0) {
+        fprintf(stderr, "Failed to write %s: %s\n", LOG_FILE, strerror(errno));
+    }
+    if (!keep) {
+        close(fd);
+    }
     pthread_mutex_unlock(&log_mutex);
+}
+
+void (log_error)(ErrorType type, const char *message, int error_code) {
+    write_log_line(type, message, error_code, NULL, NULL, NULL);
+}
+
+void log_error_event(const ErrorEvent *event) {
+    char stack[ERROR_STACK_MAX_DEPTH * 96];
+    stack[0] = '\0';
+    if (event->stack && event->stack->depth > 0) {
+        format_stack(event->stack, stack, sizeof(stack));
+    }
+    write_log_line(event->type, event->message, event->error_code, event->resource, event->site, stack);
+}
+
+void log_error_site(ErrorSite *site, const char *message, int error_code) {
+    if (!__atomic_load_n(&site->enabled, __ATOMIC_RELAXED)) {
+        return;
+    }
+    __atomic_fetch_add(&site->hits, 1, __ATOMIC_RELAXED);
+    write_log_line(site->type, message, error_code, NULL, site, NULL);
 }
\ No newline at end of file
@@ -6,6 +6,20 @@
 #include <errno.h>   // Added for ETXTBSY if used in logger
 #include <fcntl.h>   // Added for LOCK_EX, LOCK_NB, LOCK_UN if used in logger
 
+const char* error_type_to_string(ErrorType type);
 void log_error(ErrorType type, const char *message, int error_code);
 
+#if EH_MIN_SEVERITY > 0
+#define log_error(type, message, error_code)                                                  \
+    do {                                                                                      \
+        ErrorType eh_type_ = (type);                                                          \
+        if (EH_SEVERITY_ENABLED(EH_TYPE_SEVERITY(eh_type_)))                                  \
+            (log_error)(eh_type_, (message), (error_code));                                   \
+    } while (0)
+#endif
+
+// Log an event, appending " resource=<path>", " site=<file>:<line>" and its
+// captured stack as " stack=module+0xoff,..." when present
+void log_error_event(const ErrorEvent *event);
+
 #endif // LOGGER_H
\ No newline at end of file
@@ -0,0 +1,177 @@
+// File: src/memory_reclaim.c
+#define _GNU_SOURCE
+#include "memory_reclaim.h"
+#include "system_resources.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdarg.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifndef MADV_PAGEOUT
+#define MADV_PAGEOUT 21
+#endif
+
+#define RECLAIM_LOG_MAX 1024
+
+typedef struct {
+    const char *name;
+    int priority;
+    CacheShrinkFn fn;
+    void *arg;
+} CacheShrinker;
+
+typedef struct {
+    void *addr;
+    size_t length;
+    ColdRegionMode mode;
+} ColdRegion;
+
+static pthread_mutex_t reclaim_mutex = PTHREAD_MUTEX_INITIALIZER;
+static CacheShrinker shrinkers[MAX_CACHE_SHRINKERS];
+static int shrinker_count;
+static ColdRegion cold_regions[MAX_COLD_REGIONS];
+static int cold_region_count;
+
+int register_cache_shrinker(const char *name, int priority, CacheShrinkFn fn, void *arg) {
+    if (fn == NULL) {
+        return -1;
+    }
+    pthread_mutex_lock(&reclaim_mutex);
+    if (shrinker_count == MAX_CACHE_SHRINKERS) {
+        pthread_mutex_unlock(&reclaim_mutex);
+        return -1;
+    }
+    // Insert after every shrinker of equal or lower priority
+    int pos = shrinker_count;
+    while (pos > 0 && shrinkers[pos - 1].priority > priority) {
+        shrinkers[pos] = shrinkers[pos - 1];
+        pos--;
+    }
+    shrinkers[pos] = (CacheShrinker){ name ? name : "cache", priority, fn, arg };
+    shrinker_count++;
+    pthread_mutex_unlock(&reclaim_mutex);
+    return 0;
+}
+
+void unregister_cache_shrinker(CacheShrinkFn fn, void *arg) {
+    pthread_mutex_lock(&reclaim_mutex);
+    for (int i = 0; i < shrinker_count; i++) {
+        if (shrinkers[i].fn == fn && shrinkers[i].arg == arg) {
+            memmove(&shrinkers[i], &shrinkers[i + 1], (size_t)(shrinker_count - i - 1) * sizeof(shrinkers[0]));
+            shrinker_count--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&reclaim_mutex);
+}
+
+int register_cold_region(void *addr, size_t length, ColdRegionMode mode) {
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)addr + page - 1) & ~(page - 1);
+    uintptr_t end = ((uintptr_t)addr + length) & ~(page - 1);
+    if (addr == NULL || end <= start) {
+        return -1;
+    }
+    pthread_mutex_lock(&reclaim_mutex);
+    if (cold_region_count == MAX_COLD_REGIONS) {
+        pthread_mutex_unlock(&reclaim_mutex);
+        return -1;
+    }
+    // Keep the caller's address so unregister_cold_region() can find it
+    cold_regions[cold_region_count++] = (ColdRegion){ addr, length, mode };
+    pthread_mutex_unlock(&reclaim_mutex);
+    return 0;
+}
+
+void unregister_cold_region(void *addr) {
+    pthread_mutex_lock(&reclaim_mutex);
+    for (int i = 0; i < cold_region_count; i++) {
+        if (cold_regions[i].addr == addr) {
+            cold_regions[i] = cold_regions[--cold_region_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&reclaim_mutex);
+}
+
+static int advise_region(const ColdRegion *region) {
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)region->addr + page - 1) & ~(page - 1);
+    uintptr_t end = ((uintptr_t)region->addr + region->length) & ~(page - 1);
+    int advice = region->mode == COLD_REGION_PAGEOUT ? MADV_PAGEOUT : MADV_DONTNEED;
+    return madvise((void *)start, end - start, advice);
+}
+
+// Append " name=delta" to the reclaim log line
+static void note_step(char *line, size_t *len, long long freed, const char *format, ...) {
+    if (*len >= RECLAIM_LOG_MAX - 1) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line + *len, RECLAIM_LOG_MAX - *len, format, args);
+    va_end(args);
+    if (n > 0 && (size_t)n < RECLAIM_LOG_MAX - *len) {
+        *len += (size_t)n;
+        n = snprintf(line + *len, RECLAIM_LOG_MAX - *len, "=%lld", freed);
+        if (n > 0) {
+            *len += (size_t)n < RECLAIM_LOG_MAX - *len ? (size_t)n : RECLAIM_LOG_MAX - 1 - *len;
+        }
+    } else {
+        *len = RECLAIM_LOG_MAX - 1;
+    }
+}
+
+long long reclaim_memory(void) {
+    char line[RECLAIM_LOG_MAX];
+    size_t len = 0;
+    unsigned long long start_rss = process_rss_bytes();
+    unsigned long long rss = start_rss;
+    unsigned long long after;
+
+    line[0] = '\0';
+    malloc_trim(0);
+    after = process_rss_bytes();
+    note_step(line, &len, (long long)rss - (long long)after, " malloc_trim");
+    rss = after;
+
+    // Shrinkers may take their own locks but must not register or
+    // unregister while a pass is running
+    pthread_mutex_lock(&reclaim_mutex);
+    for (int i = 0; i < shrinker_count; i++) {
+        shrinkers[i].fn(shrinkers[i].arg);
+        after = process_rss_bytes();
+        note_step(line, &len, (long long)rss - (long long)after, " %s", shrinkers[i].name);
+        rss = after;
+    }
+    if (shrinker_count > 0) {
+        // Memory the shrinkers freed may still sit in the allocator
+        malloc_trim(0);
+        after = process_rss_bytes();
+        note_step(line, &len, (long long)rss - (long long)after, " malloc_trim");
+        rss = after;
+    }
+    for (int i = 0; i < cold_region_count; i++) {
+        if (advise_region(&cold_regions[i]) != 0) {
+            continue;
+        }
+        after = process_rss_bytes();
+        note_step(line, &len, (long long)rss - (long long)after, " %s@%p",
+                  cold_regions[i].mode == COLD_REGION_PAGEOUT ? "pageout" : "dontneed", cold_regions[i].addr);
+        rss = after;
+    }
+    pthread_mutex_unlock(&reclaim_mutex);
+
+    long long total = (long long)start_rss - (long long)rss;
+    char message[RECLAIM_LOG_MAX + 64];
+    snprintf(message, sizeof(message), "Reclaimed %lld bytes:%s", total, line);
+    printf("%s\n", message);
+    // A note on the recovery, like cleanup_resources(), not a new memory error
+    log_error(UNKNOWN_ERROR, message, 0);
+    return total;
+}
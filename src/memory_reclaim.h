@@ -0,0 +1,37 @@
+// File: src/memory_reclaim.h
+#ifndef MEMORY_RECLAIM_H
+#define MEMORY_RECLAIM_H
+
+#include <stddef.h>
+
+// Registrations are kept in fixed tables so reclaiming needs no memory
+#define MAX_CACHE_SHRINKERS 32
+#define MAX_COLD_REGIONS 32
+
+// Drop what an application cache can rebuild later
+typedef void (*CacheShrinkFn)(void *arg);
+
+// Shrinkers run in ascending priority, so give the cheapest-to-rebuild
+// caches the lowest number. name appears in the reclaim log and is not
+// copied. Returns 0, or -1 when the table is full.
+int register_cache_shrinker(const char *name, int priority, CacheShrinkFn fn, void *arg);
+void unregister_cache_shrinker(CacheShrinkFn fn, void *arg);
+
+typedef enum {
+    COLD_REGION_DISCARD,   // MADV_DONTNEED: contents are lost and read back as zeros
+    COLD_REGION_PAGEOUT    // MADV_PAGEOUT: contents are kept, pages go to swap
+} ColdRegionMode;
+
+// Memory that may be dropped or paged out under pressure. Only the whole
+// pages inside [addr, addr + length) are affected. Returns 0, or -1 when
+// the table is full or the range holds no whole page.
+int register_cold_region(void *addr, size_t length, ColdRegionMode mode);
+void unregister_cold_region(void *addr);
+
+// One reclamation pass: malloc_trim(0), then each shrinker, then madvise()
+// on the cold regions. RSS is measured around every step and the bytes each
+// one returned are logged. Returns the total RSS reduction in bytes, which
+// is negative if RSS grew.
+long long reclaim_memory(void);
+
+#endif // MEMORY_RECLAIM_H
@@ -0,0 +1,555 @@
+// File: src/notifier.c
+#include "notifier.h"
+#include "logger.h"
+#include "resource_registry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#define SMTP_LINE_SIZE 512
+#define DEFAULT_SMTP_SERVER "smtp.gmail.com"
+#define DEFAULT_SMTP_PORT 587
+#define DEFAULT_RECIPIENT "b22cs004@iitj.ac.in"
+#define DEFAULT_TIMEOUT_MS 10000
+#define DEFAULT_IDLE_TIMEOUT_MS 30000
+#define EXIT_FLUSH_TIMEOUT_MS 5000
+
+typedef struct {
+    ErrorType type;
+    int error_code;
+    time_t when;
+    char message[NOTIFIER_MESSAGE_SIZE];
+} NotifierRecord;
+
+typedef struct {
+    int fd;
+    void *tls;
+    int has_starttls;
+    int has_auth_plain;
+    char buf[SMTP_LINE_SIZE];
+    size_t len;
+    size_t pos;
+} SmtpConnection;
+
+static NotifierRecord queue[NOTIFIER_QUEUE_SIZE];
+static unsigned int queue_head;
+static unsigned int queue_tail;
+static int in_flight;
+static unsigned long dropped_reports;
+
+static pthread_mutex_t notifier_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t notifier_cond;
+static pthread_cond_t notifier_drained;
+static pthread_t notifier_thread;
+static pthread_once_t env_once = PTHREAD_ONCE_INIT;
+static int notifier_running;
+static int notifier_stopping;
+
+static NotifierConfig notifier_config;
+static NotifierTlsHook tls_hook;
+static int tls_hook_set;
+
+static void copy_env(char *dst, size_t size, const char *name, const char *fallback) {
+    const char *value = getenv(name);
+    if (value == NULL) {
+        value = fallback;
+    }
+    snprintf(dst, size, "%s", value);
+}
+
+void notifier_config_from_env(NotifierConfig *config) {
+    memset(config, 0, sizeof(*config));
+    copy_env(config->server, sizeof(config->server), "SMTP_SERVER", DEFAULT_SMTP_SERVER);
+    copy_env(config->sender, sizeof(config->sender), "SENDER_EMAIL", "");
+    copy_env(config->password, sizeof(config->password), "SENDER_PASSWORD", "");
+    copy_env(config->recipient, sizeof(config->recipient), "RECIPIENT_EMAIL", DEFAULT_RECIPIENT);
+    const char *port = getenv("SMTP_PORT");
+    config->port = port ? atoi(port) : DEFAULT_SMTP_PORT;
+    const char *plaintext = getenv("SMTP_ALLOW_PLAINTEXT_AUTH");
+    config->allow_plaintext_auth = plaintext && strcmp(plaintext, "1") == 0;
+    config->timeout_ms = DEFAULT_TIMEOUT_MS;
+    config->idle_timeout_ms = DEFAULT_IDLE_TIMEOUT_MS;
+}
+
+void notifier_set_tls_hook(const NotifierTlsHook *hook) {
+    pthread_mutex_lock(&notifier_mutex);
+    if (hook) {
+        tls_hook = *hook;
+        tls_hook_set = 1;
+    } else {
+        memset(&tls_hook, 0, sizeof(tls_hook));
+        tls_hook_set = 0;
+    }
+    pthread_mutex_unlock(&notifier_mutex);
+}
+
+static void base64_encode(const unsigned char *in, size_t len, char *out, size_t out_size) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t o = 0;
+    for (size_t i = 0; i < len && o + 4 < out_size; i += 3) {
+        unsigned int n = in[i] << 16;
+        if (i + 1 < len) n |= in[i + 1] << 8;
+        if (i + 2 < len) n |= in[i + 2];
+        out[o++] = alphabet[(n >> 18) & 63];
+        out[o++] = alphabet[(n >> 12) & 63];
+        out[o++] = (i + 1 < len) ? alphabet[(n >> 6) & 63] : '=';
+        out[o++] = (i + 2 < len) ? alphabet[n & 63] : '=';
+    }
+    out[o] = '\0';
+}
+
+static ssize_t smtp_raw_send(SmtpConnection *conn, const void *buf, size_t len) {
+    if (conn->tls) {
+        return tls_hook.send(conn->tls, buf, len);
+    }
+    return send(conn->fd, buf, len, MSG_NOSIGNAL);
+}
+
+static ssize_t smtp_raw_recv(SmtpConnection *conn, void *buf, size_t len) {
+    if (conn->tls) {
+        return tls_hook.recv(conn->tls, buf, len);
+    }
+    return recv(conn->fd, buf, len, 0);
+}
+
+static int smtp_write(SmtpConnection *conn, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = smtp_raw_send(conn, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int smtp_printf(SmtpConnection *conn, const char *fmt, ...) {
+    char line[SMTP_LINE_SIZE * 2];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= sizeof(line)) {
+        return -1;
+    }
+    return smtp_write(conn, line, (size_t)n);
+}
+
+// Read one CRLF-terminated line into line (without the terminator)
+static int smtp_read_line(SmtpConnection *conn, char *line, size_t size) {
+    size_t used = 0;
+    for (;;) {
+        while (conn->pos < conn->len) {
+            char c = conn->buf[conn->pos++];
+            if (c == '\n') {
+                if (used > 0 && line[used - 1] == '\r') {
+                    used--;
+                }
+                line[used] = '\0';
+                return 0;
+            }
+            if (used + 1 < size) {
+                line[used++] = c;
+            }
+        }
+        ssize_t n = smtp_raw_recv(conn, conn->buf, sizeof(conn->buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        conn->len = (size_t)n;
+        conn->pos = 0;
+    }
+}
+
+// Read a (possibly multi-line) reply and return its status code, or -1.
+// EHLO capabilities are recorded on the connection as they stream past.
+static int smtp_read_reply(SmtpConnection *conn) {
+    char line[SMTP_LINE_SIZE];
+    for (;;) {
+        if (smtp_read_line(conn, line, sizeof(line)) != 0 || strlen(line) < 3) {
+            return -1;
+        }
+        const char *text = line + 4;
+        if (strlen(line) > 4) {
+            if (strncasecmp(text, "STARTTLS", 8) == 0) {
+                conn->has_starttls = 1;
+            } else if (strncasecmp(text, "AUTH", 4) == 0 && strstr(text, "PLAIN")) {
+                conn->has_auth_plain = 1;
+            }
+        }
+        if (line[3] != '-') {
+            return atoi(line);
+        }
+    }
+}
+
+static int smtp_command(SmtpConnection *conn, int expected, const char *fmt, ...) {
+    char line[SMTP_LINE_SIZE * 2];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= sizeof(line) || smtp_write(conn, line, (size_t)n) != 0) {
+        return -1;
+    }
+    int code = smtp_read_reply(conn);
+    if (code / 100 != expected / 100) {
+        fprintf(stderr, "SMTP server rejected command (reply %d)\n", code);
+        return -1;
+    }
+    return 0;
+}
+
+static int connect_with_timeout(const char *server, int port, int timeout_ms) {
+    struct addrinfo hints = {0};
+    struct addrinfo *result = NULL;
+    char port_str[16];
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port_str, sizeof(port_str), "%d", port);
+    int rc = getaddrinfo(server, port_str, &hints, &result);
+    if (rc != 0) {
+        fprintf(stderr, "Failed to resolve SMTP server %s: %s\n", server, gai_strerror(rc));
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *ai = result; ai != NULL; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, ai->ai_protocol);
+        if (fd == -1) {
+            continue;
+        }
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+        if (errno == EINPROGRESS) {
+            struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+            int err = 0;
+            socklen_t err_len = sizeof(err);
+            if (poll(&pfd, 1, timeout_ms) == 1 &&
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) == 0 && err == 0) {
+                break;
+            }
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd == -1) {
+        fprintf(stderr, "Failed to connect to SMTP server %s:%d\n", server, port);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+static void smtp_close(SmtpConnection *conn, int send_quit) {
+    if (conn->fd == -1) {
+        return;
+    }
+    if (send_quit) {
+        smtp_command(conn, 221, "QUIT\r\n");
+    }
+    if (conn->tls) {
+        tls_hook.close(conn->tls);
+        conn->tls = NULL;
+    }
+    unprotect_fd(conn->fd);
+    close(conn->fd);
+    conn->fd = -1;
+}
+
+static int smtp_hello(SmtpConnection *conn) {
+    conn->has_starttls = 0;
+    conn->has_auth_plain = 0;
+    return smtp_command(conn, 250, "EHLO localhost\r\n");
+}
+
+static int smtp_open(SmtpConnection *conn, const NotifierConfig *config) {
+    conn->len = conn->pos = 0;
+    conn->tls = NULL;
+    conn->fd = connect_with_timeout(config->server, config->port, config->timeout_ms);
+    if (conn->fd == -1) {
+        return -1;
+    }
+    // A failed recovery must not tear down the report connection
+    protect_fd(conn->fd);
+    if (smtp_read_reply(conn) != 220 || smtp_hello(conn) != 0) {
+        goto fail;
+    }
+
+    if (conn->has_starttls && tls_hook_set) {
+        if (smtp_command(conn, 220, "STARTTLS\r\n") != 0) {
+            goto fail;
+        }
+        conn->tls = tls_hook.start(conn->fd, config->server, tls_hook.user_data);
+        if (conn->tls == NULL) {
+            fprintf(stderr, "TLS handshake with %s failed\n", config->server);
+            goto fail;
+        }
+        conn->len = conn->pos = 0;
+        if (smtp_hello(conn) != 0) {
+            goto fail;
+        }
+    }
+
+    if (config->password[0] != '\0') {
+        if (conn->tls == NULL && !config->allow_plaintext_auth) {
+            fprintf(stderr, "Refusing to send SMTP credentials without TLS.\n");
+            goto fail;
+        }
+        if (!conn->has_auth_plain) {
+            fprintf(stderr, "SMTP server does not offer AUTH PLAIN.\n");
+            goto fail;
+        }
+        unsigned char credentials[NOTIFIER_FIELD_SIZE * 2 + 2];
+        size_t user_len = strlen(config->sender);
+        size_t pass_len = strlen(config->password);
+        char encoded[sizeof(credentials) * 4 / 3 + 8];
+        credentials[0] = '\0';
+        memcpy(credentials + 1, config->sender, user_len);
+        credentials[1 + user_len] = '\0';
+        memcpy(credentials + 2 + user_len, config->password, pass_len);
+        base64_encode(credentials, user_len + pass_len + 2, encoded, sizeof(encoded));
+        if (smtp_command(conn, 235, "AUTH PLAIN %s\r\n", encoded) != 0) {
+            goto fail;
+        }
+    }
+    return 0;
+
+fail:
+    smtp_close(conn, 0);
+    return -1;
+}
+
+static int smtp_send_record(SmtpConnection *conn, const NotifierConfig *config,
+                            const NotifierRecord *record) {
+    const char *type_name = error_type_to_string(record->type);
+    char date[64];
+    struct tm tm;
+    localtime_r(&record->when, &tm);
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S %z", &tm);
+
+    if (smtp_command(conn, 250, "MAIL FROM:<%s>\r\n", config->sender) != 0 ||
+        smtp_command(conn, 250, "RCPT TO:<%s>\r\n", config->recipient) != 0 ||
+        smtp_command(conn, 354, "DATA\r\n") != 0) {
+        return -1;
+    }
+    // Every body line starts with fixed text, so no dot-stuffing is required
+    if (smtp_printf(conn,
+                    "From: %s\r\nTo: %s\r\nDate: %s\r\nSubject: OS Error Report: %s\r\n"
+                    "Content-Type: text/plain; charset=utf-8\r\n\r\n",
+                    config->sender, config->recipient, date, type_name) != 0 ||
+        smtp_printf(conn,
+                    "An error of type %s occurred.\r\nDetails: %s\r\nError Code: %d\r\n",
+                    type_name, record->message, record->error_code) != 0) {
+        return -1;
+    }
+    return smtp_command(conn, 250, ".\r\n");
+}
+
+static void deliver(SmtpConnection *conn, const NotifierRecord *record) {
+    // A reused connection may have been closed by the server; retry once on a fresh one
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int reused = conn->fd != -1;
+        if (!reused && smtp_open(conn, &notifier_config) != 0) {
+            break;
+        }
+        if (smtp_send_record(conn, &notifier_config, record) == 0) {
+            return;
+        }
+        smtp_close(conn, 0);
+        if (!reused) {
+            break;
+        }
+    }
+    fprintf(stderr, "Failed to send error report for %s.\n", error_type_to_string(record->type));
+}
+
+static void *notifier_main(void *arg) {
+    (void)arg;
+    SmtpConnection conn = { .fd = -1 };
+    NotifierRecord record;
+
+    pthread_mutex_lock(&notifier_mutex);
+    for (;;) {
+        while (queue_head == queue_tail && !notifier_stopping) {
+            if (conn.fd == -1) {
+                pthread_cond_wait(&notifier_cond, &notifier_mutex);
+                continue;
+            }
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += notifier_config.idle_timeout_ms / 1000;
+            deadline.tv_nsec += (notifier_config.idle_timeout_ms % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            if (pthread_cond_timedwait(&notifier_cond, &notifier_mutex, &deadline) == ETIMEDOUT &&
+                queue_head == queue_tail) {
+                pthread_mutex_unlock(&notifier_mutex);
+                smtp_close(&conn, 1);
+                pthread_mutex_lock(&notifier_mutex);
+            }
+        }
+        if (queue_head == queue_tail) {
+            break;
+        }
+        record = queue[queue_head % NOTIFIER_QUEUE_SIZE];
+        queue_head++;
+        in_flight = 1;
+        pthread_mutex_unlock(&notifier_mutex);
+
+        deliver(&conn, &record);
+
+        pthread_mutex_lock(&notifier_mutex);
+        in_flight = 0;
+        pthread_cond_broadcast(&notifier_drained);
+    }
+    pthread_mutex_unlock(&notifier_mutex);
+    smtp_close(&conn, 1);
+    return NULL;
+}
+
+static void notifier_atexit(void) {
+    notifier_flush(EXIT_FLUSH_TIMEOUT_MS);
+    notifier_stop();
+}
+
+int notifier_start(const NotifierConfig *config) {
+    static int atexit_registered;
+    pthread_condattr_t attr;
+
+    pthread_mutex_lock(&notifier_mutex);
+    if (notifier_running) {
+        pthread_mutex_unlock(&notifier_mutex);
+        return 0;
+    }
+    notifier_config = *config;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&notifier_cond, &attr);
+    pthread_cond_init(&notifier_drained, &attr);
+    pthread_condattr_destroy(&attr);
+    queue_head = queue_tail = 0;
+    notifier_stopping = 0;
+    if (pthread_create(&notifier_thread, NULL, notifier_main, NULL) != 0) {
+        pthread_mutex_unlock(&notifier_mutex);
+        fprintf(stderr, "Failed to start error notifier thread\n");
+        return -1;
+    }
+    notifier_running = 1;
+    if (!atexit_registered) {
+        atexit(notifier_atexit);
+        atexit_registered = 1;
+    }
+    pthread_mutex_unlock(&notifier_mutex);
+    return 0;
+}
+
+static void start_from_env(void) {
+    NotifierConfig config;
+    notifier_config_from_env(&config);
+    if (config.sender[0] == '\0') {
+        printf("Sender email not set in environment variables; error reports will not be emailed.\n");
+        return;
+    }
+    notifier_start(&config);
+}
+
+int notify_error(ErrorType type, const char *message, int error_code) {
+    pthread_once(&env_once, start_from_env);
+
+    pthread_mutex_lock(&notifier_mutex);
+    if (!notifier_running || notifier_stopping) {
+        pthread_mutex_unlock(&notifier_mutex);
+        return -1;
+    }
+    if (queue_tail - queue_head == NOTIFIER_QUEUE_SIZE) {
+        dropped_reports++;
+        pthread_mutex_unlock(&notifier_mutex);
+        return -1;
+    }
+    NotifierRecord *record = &queue[queue_tail % NOTIFIER_QUEUE_SIZE];
+    record->type = type;
+    record->error_code = error_code;
+    record->when = time(NULL);
+    snprintf(record->message, sizeof(record->message), "%s", message ? message : "");
+    // Keep the message on one line so it cannot inject headers or end DATA early
+    for (char *p = record->message; *p; p++) {
+        if (*p == '\r' || *p == '\n') {
+            *p = ' ';
+        }
+    }
+    queue_tail++;
+    pthread_cond_signal(&notifier_cond);
+    pthread_mutex_unlock(&notifier_mutex);
+    return 0;
+}
+
+int notifier_flush(int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&notifier_mutex);
+    int rc = 0;
+    while (notifier_running && (queue_head != queue_tail || in_flight)) {
+        if (pthread_cond_timedwait(&notifier_drained, &notifier_mutex, &deadline) == ETIMEDOUT) {
+            rc = -1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&notifier_mutex);
+    return rc;
+}
+
+void notifier_stop(void) {
+    pthread_mutex_lock(&notifier_mutex);
+    if (!notifier_running) {
+        pthread_mutex_unlock(&notifier_mutex);
+        return;
+    }
+    notifier_stopping = 1;
+    pthread_cond_signal(&notifier_cond);
+    pthread_mutex_unlock(&notifier_mutex);
+
+    pthread_join(notifier_thread, NULL);
+
+    pthread_mutex_lock(&notifier_mutex);
+    notifier_running = 0;
+    if (dropped_reports > 0) {
+        fprintf(stderr, "%lu error reports dropped because the notifier queue was full\n",
+                dropped_reports);
+    }
+    pthread_mutex_unlock(&notifier_mutex);
+}
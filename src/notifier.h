@@ -0,0 +1,54 @@
+// File: src/notifier.h
+#ifndef NOTIFIER_H
+#define NOTIFIER_H
+
+#include "error_handler.h"
+#include <stddef.h>
+#include <sys/types.h>
+
+#define NOTIFIER_QUEUE_SIZE 64
+#define NOTIFIER_MESSAGE_SIZE 256
+#define NOTIFIER_FIELD_SIZE 128
+
+// TLS transport used once the server accepts STARTTLS.
+// start() wraps the connected socket and returns a session, or NULL on failure.
+typedef struct {
+    void *(*start)(int fd, const char *server_name, void *user_data);
+    ssize_t (*send)(void *session, const void *buf, size_t len);
+    ssize_t (*recv)(void *session, void *buf, size_t len);
+    void (*close)(void *session);
+    void *user_data;
+} NotifierTlsHook;
+
+typedef struct {
+    char server[NOTIFIER_FIELD_SIZE];
+    int port;
+    char sender[NOTIFIER_FIELD_SIZE];
+    char password[NOTIFIER_FIELD_SIZE];
+    char recipient[NOTIFIER_FIELD_SIZE];
+    int allow_plaintext_auth;   // Send AUTH even when no TLS session is active
+    int timeout_ms;             // Connect and per-reply timeout
+    int idle_timeout_ms;        // Close the reused connection after this long without mail
+} NotifierConfig;
+
+// Fill config from SMTP_SERVER, SMTP_PORT, SENDER_EMAIL, SENDER_PASSWORD,
+// RECIPIENT_EMAIL and SMTP_ALLOW_PLAINTEXT_AUTH
+void notifier_config_from_env(NotifierConfig *config);
+
+// Start the background sender thread. Returns 0 on success.
+int notifier_start(const NotifierConfig *config);
+
+// Install (or clear with NULL) the STARTTLS transport. Call before notifier_start().
+void notifier_set_tls_hook(const NotifierTlsHook *hook);
+
+// Queue an error report without blocking. Starts the notifier from the
+// environment on first use. Returns 0 if queued, -1 if disabled or the queue is full.
+int notify_error(ErrorType type, const char *message, int error_code);
+
+// Wait until the queue drains or timeout_ms elapses. Returns 0 if drained.
+int notifier_flush(int timeout_ms);
+
+// Send QUIT, close the connection and join the sender thread
+void notifier_stop(void);
+
+#endif // NOTIFIER_H
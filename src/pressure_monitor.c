@@ -0,0 +1,292 @@
+// File: src/pressure_monitor.c
+#define _GNU_SOURCE
+#include "pressure_monitor.h"
+#include "system_resources.h"
+#include "resource_registry.h"
+#include "handler_registry.h"
+#include "memory_reclaim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+typedef struct {
+    const char *name;
+    ErrorType type;
+    unsigned int stall_us;
+    unsigned int window_us;
+    int fd;
+    char path[PATH_MAX];
+    unsigned long long notified_ns;   // Last notification sent for this trigger
+} PressureTrigger;
+
+#define UNPRIVILEGED_WINDOW_US 2000000
+// A trigger fires every window while pressure lasts; mail about it at most this often
+#define NOTIFY_INTERVAL_NS (10 * 60 * 1000000000ULL)
+
+static PressureTrigger triggers[PRESSURE_RESOURCE_COUNT] = {
+    [PRESSURE_MEMORY] = { "memory", MEMORY_ERROR, 200000, 2000000, -1, "", 0 },
+    [PRESSURE_IO] = { "io", DEVICE_BUSY, 600000, 2000000, -1, "", 0 },
+    [PRESSURE_CPU] = { "cpu", DEVICE_BUSY, 1000000, 2000000, -1, "", 0 },
+};
+
+static pthread_mutex_t monitor_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int monitor_started;
+
+// Triggers that fired and await handling; bit i is resource i
+static pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pending_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int pending;
+
+void pressure_set_trigger(PressureResource resource, unsigned int stall_us, unsigned int window_us) {
+    if ((unsigned)resource >= PRESSURE_RESOURCE_COUNT || stall_us == 0 || stall_us > window_us) {
+        return;
+    }
+    pthread_mutex_lock(&monitor_mutex);
+    triggers[resource].stall_us = stall_us;
+    triggers[resource].window_us = window_us;
+    pthread_mutex_unlock(&monitor_mutex);
+}
+
+double pressure_threshold(PressureResource resource) {
+    if ((unsigned)resource >= PRESSURE_RESOURCE_COUNT) {
+        return 100.0;
+    }
+    return 100.0 * triggers[resource].stall_us / triggers[resource].window_us;
+}
+
+// Prefer the cgroup's own pressure file, which only counts our tasks
+static int open_pressure_file(const char *name, int flags, char *path, size_t size) {
+    char file[32];
+    int fd = -1;
+    snprintf(file, sizeof(file), "%s.pressure", name);
+    if (cgroup_file_path(file, path, size) == 0) {
+        fd = open(path, flags | O_CLOEXEC);
+    }
+    if (fd == -1) {
+        snprintf(path, size, "/proc/pressure/%s", name);
+        fd = open(path, flags | O_CLOEXEC);
+    }
+    return fd;
+}
+
+static int open_trigger(PressureTrigger *trigger) {
+    char spec[64];
+    trigger->fd = open_pressure_file(trigger->name, O_RDWR | O_NONBLOCK, trigger->path, sizeof(trigger->path));
+    if (trigger->fd == -1) {
+        trigger->path[0] = '\0';
+        return -1;
+    }
+
+    int len = snprintf(spec, sizeof(spec), "some %u %u", trigger->stall_us, trigger->window_us);
+    // The trigger string must be written with its terminating NUL
+    int rc = (int)write(trigger->fd, spec, (size_t)len + 1);
+    if (rc < 0 && errno == EINVAL && trigger->window_us % UNPRIVILEGED_WINDOW_US != 0) {
+        // Without CAP_SYS_RESOURCE the window must be a multiple of 2 s;
+        // widen it and keep the same stall share
+        unsigned int window = (trigger->window_us / UNPRIVILEGED_WINDOW_US + 1) * UNPRIVILEGED_WINDOW_US;
+        trigger->stall_us = (unsigned int)((unsigned long long)trigger->stall_us * window / trigger->window_us);
+        trigger->window_us = window;
+        len = snprintf(spec, sizeof(spec), "some %u %u", trigger->stall_us, trigger->window_us);
+        rc = (int)write(trigger->fd, spec, (size_t)len + 1);
+    }
+    if (rc < 0) {
+        fprintf(stderr, "Cannot register %s pressure trigger on %s: %s\n", trigger->name, trigger->path,
+                strerror(errno));
+        close(trigger->fd);
+        trigger->fd = -1;
+        return -1;
+    }
+    protect_fd(trigger->fd);
+    return 0;
+}
+
+// An early warning, not a failure: log it, notify now and then, reclaim
+// what the process can spare and wait for the stall to ease. Unlike a
+// MEMORY_ERROR it neither spends the emergency reserve nor runs cleanup.
+static void handle_pressure(PressureResource resource) {
+    PressureTrigger *trigger = &triggers[resource];
+    char message[128];
+    struct timespec now;
+    snprintf(message, sizeof(message), "%s pressure: tasks stalled over %u ms in %u ms", trigger->name,
+             trigger->stall_us / 1000, trigger->window_us / 1000);
+    ErrorEvent event = { .type = trigger->type, .message = message, .resource = trigger->path,
+                         .severity = SEVERITY_WARNING, .retryable = 1 };
+    if (!EH_SEVERITY_ENABLED(event.severity)) {
+        return;
+    }
+    run_error_handlers(&event, HANDLER_STAGE_LOG, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    unsigned long long now_ns = (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+    if (trigger->notified_ns == 0 || now_ns - trigger->notified_ns >= NOTIFY_INTERVAL_NS) {
+        trigger->notified_ns = now_ns;
+        run_error_handlers(&event, HANDLER_STAGE_NOTIFY, NULL);
+    }
+
+    if (resource == PRESSURE_MEMORY) {
+        reclaim_memory();
+    }
+    recover_from_pressure(resource, trigger->type, NULL);
+    run_error_handlers(&event, HANDLER_STAGE_CUSTOM, NULL);
+}
+
+// Handles the events, recovery included, so the poll thread never blocks
+// on it. A trigger that fires again while its event is being handled is
+// handled once more afterwards rather than queued per firing.
+static void *handler_main(void *arg) {
+    (void)arg;
+    error_handler_init();
+    for (;;) {
+        pthread_mutex_lock(&pending_mutex);
+        while (pending == 0) {
+            pthread_cond_wait(&pending_cond, &pending_mutex);
+        }
+        unsigned int fired = pending;
+        pending = 0;
+        pthread_mutex_unlock(&pending_mutex);
+
+        for (int i = 0; i < PRESSURE_RESOURCE_COUNT; i++) {
+            if (fired & (1u << i)) {
+                handle_pressure((PressureResource)i);
+            }
+        }
+    }
+    return NULL;
+}
+
+static void *monitor_main(void *arg) {
+    (void)arg;
+    struct pollfd pfds[PRESSURE_RESOURCE_COUNT];
+    int resources[PRESSURE_RESOURCE_COUNT];
+    int count = 0;
+    for (int i = 0; i < PRESSURE_RESOURCE_COUNT; i++) {
+        if (triggers[i].fd != -1) {
+            pfds[count].fd = triggers[i].fd;
+            pfds[count].events = POLLPRI;
+            resources[count++] = i;
+        }
+    }
+
+    while (count > 0) {
+        if (poll(pfds, (nfds_t)count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            if (pfds[i].revents & (POLLERR | POLLNVAL)) {
+                // The cgroup went away or the descriptor was closed
+                pfds[i].fd = -1;
+            } else if (pfds[i].revents & POLLPRI) {
+                pthread_mutex_lock(&pending_mutex);
+                pending |= 1u << resources[i];
+                pthread_cond_signal(&pending_cond);
+                pthread_mutex_unlock(&pending_mutex);
+            }
+        }
+    }
+    return NULL;
+}
+
+int pressure_monitor_start(void) {
+    int registered = 0;
+    pthread_mutex_lock(&monitor_mutex);
+    if (monitor_started) {
+        pthread_mutex_unlock(&monitor_mutex);
+        return 0;
+    }
+    for (int i = 0; i < PRESSURE_RESOURCE_COUNT; i++) {
+        if (open_trigger(&triggers[i]) == 0) {
+            registered++;
+        }
+    }
+    if (registered > 0) {
+        pthread_t thread, handler;
+        int started = pthread_create(&handler, NULL, handler_main, NULL) == 0;
+        if (started) {
+            pthread_detach(handler);
+            // Should this fail, the handler thread just waits for nothing
+            started = pthread_create(&thread, NULL, monitor_main, NULL) == 0;
+        }
+        if (!started) {
+            for (int i = 0; i < PRESSURE_RESOURCE_COUNT; i++) {
+                if (triggers[i].fd != -1) {
+                    unprotect_fd(triggers[i].fd);
+                    close(triggers[i].fd);
+                    triggers[i].fd = -1;
+                }
+            }
+            registered = 0;
+        } else {
+            pthread_detach(thread);
+            monitor_started = 1;
+        }
+    }
+    pthread_mutex_unlock(&monitor_mutex);
+    return registered > 0 ? registered : -1;
+}
+
+int pressure_resource_of(const char *path) {
+    if (path == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < PRESSURE_RESOURCE_COUNT; i++) {
+        if (triggers[i].path[0] != '\0' && strcmp(triggers[i].path, path) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int pressure_sample(PressureResource resource, PressureSample *sample) {
+    char buf[256];
+    char path[PATH_MAX];
+    struct timespec now;
+    if ((unsigned)resource >= PRESSURE_RESOURCE_COUNT) {
+        return -1;
+    }
+
+    // The trigger descriptor reads like the plain file
+    int fd = triggers[resource].fd;
+    int own_fd = fd == -1;
+    if (own_fd) {
+        fd = open_pressure_file(triggers[resource].name, O_RDONLY, path, sizeof(path));
+        if (fd == -1) {
+            return -1;
+        }
+    }
+    ssize_t len = pread(fd, buf, sizeof(buf) - 1, 0);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (own_fd) {
+        close(fd);
+    }
+    if (len <= 0) {
+        return -1;
+    }
+    buf[len] = '\0';
+
+    const char *total = strstr(buf, "some ");
+    total = total ? strstr(total, "total=") : NULL;
+    if (total == NULL) {
+        return -1;
+    }
+    sample->stall_us = strtoull(total + 6, NULL, 10);
+    sample->at_ns = (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+    return 0;
+}
+
+double pressure_stall_percent(const PressureSample *from, const PressureSample *to) {
+    if (to->at_ns <= from->at_ns) {
+        return 0.0;
+    }
+    double elapsed_us = (double)(to->at_ns - from->at_ns) / 1000.0;
+    return 100.0 * (double)(to->stall_us - from->stall_us) / elapsed_us;
+}
@@ -0,0 +1,51 @@
+// File: src/pressure_monitor.h
+#ifndef PRESSURE_MONITOR_H
+#define PRESSURE_MONITOR_H
+
+#include "error_handler.h"
+
+typedef enum {
+    PRESSURE_MEMORY,
+    PRESSURE_IO,
+    PRESSURE_CPU,
+    PRESSURE_RESOURCE_COUNT
+} PressureResource;
+
+// Raise an error when tasks stall on resource for stall_us within any
+// window_us ("some" in PSI terms). Call before pressure_monitor_start().
+// Defaults: memory 200 ms/2 s, io 600 ms/2 s, cpu 1 s/2 s. Without
+// CAP_SYS_RESOURCE the kernel only accepts windows in multiples of 2 s;
+// other windows are widened with the stall scaled to match.
+void pressure_set_trigger(PressureResource resource, unsigned int stall_us, unsigned int window_us);
+
+// Register PSI triggers on this process's cgroup (memory.pressure, ...) or,
+// failing that, /proc/pressure/{memory,io,cpu}, and start a thread that
+// sleeps in poll() until one fires and a second one that handles the
+// events. Memory pressure is reported as MEMORY_ERROR, io and cpu pressure
+// as DEVICE_BUSY, with the pressure file as the resource. The event runs
+// the log, notify (at most every 10 minutes per trigger) and custom
+// handlers, and in place of the recover stage reclaim_memory() for memory
+// pressure and recover_from_pressure(). error_handler_init() calls this
+// when EH_PRESSURE_MONITOR is set.
+// Returns the number of triggers registered, or -1 if PSI is unavailable.
+int pressure_monitor_start(void);
+
+// The resource whose pressure file is path, or -1 if path is not one
+int pressure_resource_of(const char *path);
+
+// Cumulative "some" stall time of resource at one moment
+typedef struct {
+    unsigned long long at_ns;
+    unsigned long long stall_us;
+} PressureSample;
+
+// Take a sample; returns 0, or -1 when the pressure file cannot be read
+int pressure_sample(PressureResource resource, PressureSample *sample);
+
+// Percentage of the time between two samples during which tasks stalled
+double pressure_stall_percent(const PressureSample *from, const PressureSample *to);
+
+// Stall percentage above which resource counts as under pressure
+double pressure_threshold(PressureResource resource);
+
+#endif // PRESSURE_MONITOR_H
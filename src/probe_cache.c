@@ -0,0 +1,223 @@
+// File: src/probe_cache.c
+#define _GNU_SOURCE
+#include "probe_cache.h"
+#include "resource_registry.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/inotify.h>
+
+#define PROBE_CACHE_BUCKETS 64
+#define PROBE_CACHE_WAYS 4
+#define PROBE_CACHE_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF)
+
+typedef struct {
+    ProbeFn probe;
+    int result;
+    int wd;
+    unsigned long long expires_ns;
+    char path[PROBE_CACHE_PATH_MAX];
+    const char *name;   // Final component of path
+} ProbeEntry;
+
+static pthread_rwlock_t cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+static ProbeEntry cache[PROBE_CACHE_BUCKETS][PROBE_CACHE_WAYS];
+static unsigned int ttl_ms = PROBE_CACHE_TTL_MS;
+static unsigned int negative_ttl_ms = PROBE_CACHE_NEGATIVE_TTL_MS;
+
+static pthread_once_t watch_once = PTHREAD_ONCE_INIT;
+static int watch_fd = -1;
+// Bumped on every invalidation so a probe that raced one is not cached
+static atomic_ulong invalidations;
+
+static unsigned long long now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+// FNV-1a over the path, mixed with the probe so each check gets its own entry
+static unsigned int bucket_of(const char *path, ProbeFn probe) {
+    uint64_t hash = 0xcbf29ce484222325ULL ^ (uint64_t)(uintptr_t)probe;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        hash = (hash ^ *p) * 0x100000001b3ULL;
+    }
+    return (unsigned int)(hash % PROBE_CACHE_BUCKETS);
+}
+
+// Caller holds cache_lock for writing
+static void invalidate_where(int wd, const char *name) {
+    for (int b = 0; b < PROBE_CACHE_BUCKETS; b++) {
+        for (int w = 0; w < PROBE_CACHE_WAYS; w++) {
+            ProbeEntry *entry = &cache[b][w];
+            if (entry->probe != NULL && (wd == -1 || entry->wd == wd) &&
+                (name == NULL || strcmp(entry->name, name) == 0)) {
+                entry->probe = NULL;
+            }
+        }
+    }
+}
+
+static void *watch_main(void *arg) {
+    (void)arg;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        struct pollfd pfd = { .fd = watch_fd, .events = POLLIN };
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        ssize_t len = read(watch_fd, buf, sizeof(buf));
+        if (len <= 0) {
+            if (len < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            break;
+        }
+        atomic_fetch_add(&invalidations, 1);
+        pthread_rwlock_wrlock(&cache_lock);
+        for (char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            if (event->mask & IN_Q_OVERFLOW) {
+                invalidate_where(-1, NULL);
+            } else {
+                // Events about the directory itself carry no name
+                invalidate_where(event->wd, event->len > 0 ? event->name : NULL);
+            }
+        }
+        pthread_rwlock_unlock(&cache_lock);
+    }
+    return NULL;
+}
+
+static void start_watcher(void) {
+    int fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (fd == -1) {
+        return;
+    }
+    pthread_t thread;
+    watch_fd = fd;
+    if (protect_fd(fd) != 0 || pthread_create(&thread, NULL, watch_main, NULL) != 0) {
+        unprotect_fd(fd);
+        close(fd);
+        watch_fd = -1;
+        return;
+    }
+    pthread_detach(thread);
+}
+
+// Without a watch the entry only expires by TTL
+static int watch_parent(const char *path) {
+    char dir_buf[PROBE_CACHE_PATH_MAX];
+    pthread_once(&watch_once, start_watcher);
+    if (watch_fd == -1) {
+        return -1;
+    }
+    snprintf(dir_buf, sizeof(dir_buf), "%s", path);
+    // Watching the same directory again returns the same descriptor
+    return inotify_add_watch(watch_fd, dirname(dir_buf), PROBE_CACHE_EVENTS | IN_ONLYDIR);
+}
+
+static ProbeEntry *find_entry(unsigned int bucket, const char *path, ProbeFn probe) {
+    for (int w = 0; w < PROBE_CACHE_WAYS; w++) {
+        ProbeEntry *entry = &cache[bucket][w];
+        if (entry->probe == probe && strcmp(entry->path, path) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Caller holds cache_lock for writing; reuse the entry, else a free or
+// expired way, else the one closest to expiring
+static ProbeEntry *slot_for(unsigned int bucket, const char *path, ProbeFn probe, unsigned long long now) {
+    ProbeEntry *entry = find_entry(bucket, path, probe);
+    if (entry != NULL) {
+        return entry;
+    }
+    ProbeEntry *victim = &cache[bucket][0];
+    for (int w = 0; w < PROBE_CACHE_WAYS; w++) {
+        entry = &cache[bucket][w];
+        if (entry->probe == NULL || entry->expires_ns <= now) {
+            return entry;
+        }
+        if (entry->expires_ns < victim->expires_ns) {
+            victim = entry;
+        }
+    }
+    return victim;
+}
+
+int probe_cached(const char *path, ProbeFn probe) {
+    size_t len = strlen(path);
+    if (len == 0 || len >= PROBE_CACHE_PATH_MAX) {
+        return probe(path);
+    }
+    unsigned int bucket = bucket_of(path, probe);
+
+    pthread_rwlock_rdlock(&cache_lock);
+    ProbeEntry *entry = find_entry(bucket, path, probe);
+    if (entry != NULL && entry->expires_ns > now_ns()) {
+        int result = entry->result;
+        pthread_rwlock_unlock(&cache_lock);
+        return result;
+    }
+    unsigned int lifetime_ms[2] = { negative_ttl_ms, ttl_ms };
+    pthread_rwlock_unlock(&cache_lock);
+
+    // Watch before probing so a change during the probe is not missed
+    int wd = watch_parent(path);
+    unsigned long seen = atomic_load(&invalidations);
+    int result = probe(path);
+    unsigned int lifetime = lifetime_ms[result != 0];
+    if (lifetime == 0) {
+        return result;
+    }
+
+    pthread_rwlock_wrlock(&cache_lock);
+    if (atomic_load(&invalidations) == seen) {
+        unsigned long long now = now_ns();
+        entry = slot_for(bucket, path, probe, now);
+        memcpy(entry->path, path, len + 1);
+        const char *slash = strrchr(entry->path, '/');
+        entry->name = slash ? slash + 1 : entry->path;
+        entry->wd = wd;
+        entry->result = result;
+        entry->expires_ns = now + (unsigned long long)lifetime * 1000000ULL;
+        entry->probe = probe;
+    }
+    pthread_rwlock_unlock(&cache_lock);
+    return result;
+}
+
+void probe_cache_invalidate(const char *path) {
+    pthread_rwlock_wrlock(&cache_lock);
+    // A probe that started before this must not store its result
+    atomic_fetch_add(&invalidations, 1);
+    for (int b = 0; b < PROBE_CACHE_BUCKETS; b++) {
+        for (int w = 0; w < PROBE_CACHE_WAYS; w++) {
+            if (cache[b][w].probe != NULL && strcmp(cache[b][w].path, path) == 0) {
+                cache[b][w].probe = NULL;
+            }
+        }
+    }
+    pthread_rwlock_unlock(&cache_lock);
+}
+
+void probe_cache_set_ttl(unsigned int ttl, unsigned int negative_ttl) {
+    pthread_rwlock_wrlock(&cache_lock);
+    ttl_ms = ttl;
+    negative_ttl_ms = negative_ttl;
+    invalidate_where(-1, NULL);
+    pthread_rwlock_unlock(&cache_lock);
+}
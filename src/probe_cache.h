@@ -0,0 +1,31 @@
+// File: src/probe_cache.h
+#ifndef PROBE_CACHE_H
+#define PROBE_CACHE_H
+
+// Healthy results are reused for this long. Failures are not cached by
+// default: retry backoff is fully jittered, so the next attempt may come
+// at once, and a cached failure would only repeat the last answer.
+#define PROBE_CACHE_TTL_MS 500
+#define PROBE_CACHE_NEGATIVE_TTL_MS 0
+
+// Paths longer than this are probed every time
+#define PROBE_CACHE_PATH_MAX 256
+
+// A health check of path: nonzero when healthy
+typedef int (*ProbeFn)(const char *path);
+
+// probe(path), or its result from the last PROBE_CACHE_TTL_MS. The parent
+// directory is watched with inotify, so creating, deleting, renaming or
+// changing the permissions of path drops the cached result at once.
+// Threads asking about the same path at the same time may each probe.
+int probe_cached(const char *path, ProbeFn probe);
+
+// Drop every cached result for path (all probes). Recovery does this for
+// the failing file or device before it starts checking it.
+void probe_cache_invalidate(const char *path);
+
+// Change the lifetimes of healthy and failed results; 0 disables caching
+// of that kind
+void probe_cache_set_ttl(unsigned int ttl_ms, unsigned int negative_ttl_ms);
+
+#endif // PROBE_CACHE_H
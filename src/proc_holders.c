@@ -0,0 +1,195 @@
+// File: src/proc_holders.c
+#define _GNU_SOURCE
+#include "proc_holders.h"
+#include "resource_registry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+#define PROC_HOLDERS_MAX_WAIT 64
+#define KILL_POLL_INTERVAL_MS 50
+
+// Overlay filesystems report the lower device in maps, so fall back to
+// comparing the mapped path when the device does not match
+static int maps_reference(pid_t pid, const struct stat *target, const char *real_path) {
+    char maps_path[64];
+    char line[PATH_MAX + 128];
+    snprintf(maps_path, sizeof(maps_path), "/proc/%d/maps", (int)pid);
+    FILE *maps = fopen(maps_path, "r");
+    if (maps == NULL) {
+        return 0;
+    }
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), maps)) {
+        unsigned int dev_major, dev_minor;
+        unsigned long inode;
+        int path_offset = 0;
+        if (sscanf(line, "%*s %*s %*s %x:%x %lu %n", &dev_major, &dev_minor, &inode, &path_offset) < 3 ||
+            inode != (unsigned long)target->st_ino) {
+            continue;
+        }
+        if (makedev(dev_major, dev_minor) == target->st_dev) {
+            found = 1;
+        } else if (real_path != NULL && path_offset > 0) {
+            line[strcspn(line, "\n")] = '\0';
+            found = strcmp(line + path_offset, real_path) == 0;
+        }
+    }
+    fclose(maps);
+    return found;
+}
+
+int find_file_executors(const char *path, pid_t *pids, int max_pids) {
+    struct stat target;
+    char real_path[PATH_MAX];
+    if (stat(path, &target) != 0) {
+        return -1;
+    }
+    int have_real_path = realpath(path, real_path) != NULL;
+
+    DIR *proc = opendir("/proc");
+    if (proc == NULL) {
+        return -1;
+    }
+    pid_t self = getpid();
+    int count = 0;
+    struct dirent *entry;
+    while (count < max_pids && (entry = readdir(proc)) != NULL) {
+        char *end;
+        long pid = strtol(entry->d_name, &end, 10);
+        if (*end != '\0' || pid <= 0 || pid == self) {
+            continue;
+        }
+        char exe_path[64];
+        struct stat exe;
+        snprintf(exe_path, sizeof(exe_path), "/proc/%ld/exe", pid);
+        if ((stat(exe_path, &exe) == 0 && exe.st_dev == target.st_dev && exe.st_ino == target.st_ino) ||
+            maps_reference((pid_t)pid, &target, have_real_path ? real_path : NULL)) {
+            pids[count++] = (pid_t)pid;
+        }
+    }
+    closedir(proc);
+    return count;
+}
+
+// pidfds are protected while open so an EH_FD_CLEANUP=all pass on another
+// thread cannot close them under the wait
+static void close_pidfd(int fd) {
+    unprotect_fd(fd);
+    close(fd);
+}
+
+static long remaining_ms(const struct timespec *deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long ms = (long)(deadline->tv_sec - now.tv_sec) * 1000 + (deadline->tv_nsec - now.tv_nsec) / 1000000;
+    return ms < 0 ? 0 : ms;
+}
+
+static int wait_with_kill(const pid_t *pids, int count, int timeout_ms, const struct timespec *deadline,
+                          CancelToken *cancel) {
+    for (;;) {
+        int alive = 0;
+        for (int i = 0; i < count; i++) {
+            if (kill(pids[i], 0) == 0 || errno == EPERM) {
+                alive++;
+            }
+        }
+        if (alive == 0) {
+            return 0;
+        }
+        if (timeout_ms >= 0 && remaining_ms(deadline) == 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        if (cancel_sleep_until(cancel, monotonic_now_ns() + KILL_POLL_INTERVAL_MS * 1000000ULL) != 0) {
+            errno = ECANCELED;
+            return -1;
+        }
+    }
+}
+
+int wait_for_pids_exit(const pid_t *pids, int count, int timeout_ms, CancelToken *cancel) {
+    // One extra slot for the cancellation descriptor
+    struct pollfd pfds[PROC_HOLDERS_MAX_WAIT + 1];
+    struct timespec deadline;
+    int open_count = 0;
+
+    if (count > PROC_HOLDERS_MAX_WAIT) {
+        count = PROC_HOLDERS_MAX_WAIT;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    if (timeout_ms >= 0) {
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        int fd = (int)syscall(SYS_pidfd_open, pids[i], 0);
+        if (fd == -1) {
+            if (errno == ESRCH) {
+                continue;   // Already gone
+            }
+            for (int j = 0; j < open_count; j++) {
+                close_pidfd(pfds[j].fd);
+            }
+            return wait_with_kill(pids, count, timeout_ms, &deadline, cancel);
+        }
+        protect_fd(fd);
+        pfds[open_count].fd = fd;
+        pfds[open_count].events = POLLIN;
+        open_count++;
+    }
+
+    int result = 0;
+    while (open_count > 0) {
+        int wait_ms = timeout_ms < 0 ? -1 : (int)remaining_ms(&deadline);
+        pfds[open_count].fd = cancel_token_fd(cancel);
+        pfds[open_count].events = POLLIN;
+        pfds[open_count].revents = 0;
+        int ready = poll(pfds, (nfds_t)open_count + 1, wait_ms);
+        if (ready == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0 || pfds[open_count].revents != 0) {
+            if (ready == 0) {
+                errno = ETIMEDOUT;
+            } else if (ready > 0) {
+                errno = ECANCELED;
+            }
+            result = -1;
+            break;
+        }
+        // A pidfd becomes readable when its process exits
+        for (int i = 0; i < open_count;) {
+            if (pfds[i].revents != 0) {
+                close_pidfd(pfds[i].fd);
+                pfds[i] = pfds[--open_count];
+            } else {
+                i++;
+            }
+        }
+    }
+    for (int i = 0; i < open_count; i++) {
+        close_pidfd(pfds[i].fd);
+    }
+    return result;
+}
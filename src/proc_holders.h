@@ -0,0 +1,21 @@
+// File: src/proc_holders.h
+#ifndef PROC_HOLDERS_H
+#define PROC_HOLDERS_H
+
+#include "cancel.h"
+#include <sys/types.h>
+
+// Find the processes executing path or holding it mapped, by scanning
+// /proc/*/exe and /proc/*/maps once. The calling process is skipped.
+// Stores up to max_pids PIDs and returns how many were stored, or -1 if
+// path or /proc cannot be read.
+int find_file_executors(const char *path, pid_t *pids, int max_pids);
+
+// Wait until every process in pids has exited, using pidfds so the wait ends
+// the moment the last one goes away (kernels without pidfd_open fall back
+// to checking with kill(pid, 0)). Returns 0, or -1 with errno ETIMEDOUT if
+// timeout_ms (-1 = forever) passes first or ECANCELED if cancel (optional)
+// is cancelled.
+int wait_for_pids_exit(const pid_t *pids, int count, int timeout_ms, CancelToken *cancel);
+
+#endif // PROC_HOLDERS_H
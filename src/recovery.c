@@ -1,10 +1,23 @@
 #include "recovery.h"
 #include "logger.h"
+#include "handler_registry.h"
+#include "recovery_guard.h"
+#include "retry.h"
+#include "file_watch.h"
+#include "proc_holders.h"
+#include "lock_wait.h"
+#include "system_resources.h"
+#include "pressure_monitor.h"
+#include "resource_registry.h"
+#include "memory_reclaim.h"
+#include "device_probe.h"
+#include "probe_cache.h"
+#include "cancel.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
-#include <sys/resource.h>
+#include <limits.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -12,105 +25,169 @@
 #include <sys/ioctl.h>
 #include <termios.h>
 #include <signal.h>
+#include <sys/file.h>
+#include <time.h>
 
-#define MAX_RETRIES 3
-#define RETRY_DELAY 2
 #define MAX_MEMORY_THRESHOLD 0.9
+#define TXT_BUSY_MAX_HOLDERS 64
+#define PRESSURE_MIN_SAMPLE_NS 100000000ULL
+#define DEVICE_PROBE_TIMEOUT_MS 500
 
-unsigned long get_system_memory(void);
-static int check_device_status(const char *device_path);
-static int reset_device(const char *device_path);
+void cleanup_resources(void) {
+    printf("Cleaning up system resources...\n");
+    int closed = cleanup_fds();
+    printf("Closed %d file descriptors\n", closed);
+    int ipc_removed = cleanup_ipc();
+    int temp_removed = cleanup_temp_files();
+    printf("Removed %d IPC objects and %d temporary files\n", ipc_removed, temp_removed);
+    log_error(UNKNOWN_ERROR, "System resources cleanup performed", 0);
+}
 
-unsigned long get_system_memory(void) {
-    FILE *meminfo = fopen("/proc/meminfo", "r");
-    if (meminfo == NULL) {
-        return 8L * 1024 * 1024;
+int verify_system_resources(void) {
+    return memory_usage_ratio() < MAX_MEMORY_THRESHOLD;
+}
+
+// Retry policy for type, limited to the caller's attempt budget if any
+static void context_policy(ErrorType type, const ErrorContext *context, RetryPolicy *policy) {
+    get_retry_policy(type, policy);
+    if (context && context->attempt_budget > 0) {
+        policy->max_attempts = context->attempt_budget;
     }
+}
 
-    unsigned long total_memory = 0;
-    char line[256];
-    while (fgets(line, sizeof(line), meminfo)) {
-        if (strncmp(line, "MemTotal:", 9) == 0) {
-            sscanf(line, "MemTotal: %lu kB", &total_memory);
-            total_memory *= 1024;
-            break;
-        }
+static unsigned long long context_deadline(const ErrorContext *context) {
+    return context ? context->deadline_ns : 0;
+}
+
+static CancelToken *context_cancel(const ErrorContext *context) {
+    return context ? context->cancel : NULL;
+}
+
+// How long one wait may block: the policy's time limit, cut short by the
+// caller's deadline. -1 when neither applies, 0 when only one attempt is allowed.
+static int context_timeout_ms(const ErrorContext *context, const RetryPolicy *policy) {
+    if (policy->max_attempts == 1) {
+        return 0;
     }
-    fclose(meminfo);
-    return total_memory ? total_memory : 8L * 1024 * 1024;
+    return deadline_timeout_ms(context_deadline(context),
+                               policy->max_elapsed_ms > 0 ? (int)policy->max_elapsed_ms : -1);
 }
 
-static int check_device_status(const char *device_path) {
-    struct stat st;
-    if (stat(device_path, &st) == 0) {
-        int fd = open(device_path, O_RDONLY | O_NONBLOCK);
-        if (fd != -1) {
-            close(fd);
-            return 1;
-        }
+// ECANCELED or ETIMEDOUT once the caller no longer wants the recovery, else 0
+static int context_stopped(const ErrorContext *context) {
+    if (cancel_token_cancelled(context_cancel(context))) {
+        return ECANCELED;
     }
-    return 0;
+    return deadline_passed(context_deadline(context)) ? ETIMEDOUT : 0;
 }
 
-static int reset_device(const char *device_path) {
-    int fd = open(device_path, O_RDWR);
-    if (fd != -1) {
-        ioctl(fd, TIOCEXCL, 0);
-        ioctl(fd, TIOCNXCL, 0);
-        close(fd);
-        return 1;
+// The resource a recovery should act on: the device or the path, whichever
+// is preferred and known, else what the descriptor refers to. NULL when the
+// context names nothing.
+static const char *context_resource(const ErrorContext *context, int prefer_device, char *buf, size_t size) {
+    if (context == NULL) {
+        return NULL;
+    }
+    const char *first = prefer_device ? context->device : context->path;
+    const char *second = prefer_device ? context->path : context->device;
+    if (first || second) {
+        return first ? first : second;
+    }
+    if (context->fd >= 0) {
+        char link[32];
+        snprintf(link, sizeof(link), "/proc/self/fd/%d", context->fd);
+        ssize_t len = readlink(link, buf, size - 1);
+        // Sockets and pipes read as "socket:[...]"; only paths are usable
+        if (len > 0 && buf[0] == '/') {
+            buf[len] = '\0';
+            return buf;
+        }
     }
-    return 0;
+    return NULL;
 }
 
-void cleanup_resources(void) {
-    printf("Cleaning up system resources...\n");
-    for (int fd = 3; fd < 1024; fd++) {
-        close(fd);
+static int file_readable(const char *path) {
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
     }
-    system("ipcrm -a");
-    system("rm -f /tmp/error_handler_*");
-    log_error(UNKNOWN_ERROR, "System resources cleanup performed", 0);
+    close(fd);
+    return 1;
 }
 
-int verify_system_resources(void) {
-    struct rusage usage;
-    if (getrusage(RUSAGE_SELF, &usage) == 0) {
-        if (usage.ru_maxrss > (MAX_MEMORY_THRESHOLD * get_system_memory())) {
-            return 0;
-        }
-        return 1;
+// Report the source that became readable: the file itself or its backup
+static RecoveryStatus file_found(int source) {
+    printf(source == 0 ? "Successfully accessed file\n" : "Successfully accessed backup file\n");
+    return source == 0 ? RECOVERY_SUCCESS : RECOVERY_PARTIAL;
+}
+
+// filepath with ".backup" appended, or NULL when that does not fit in buf
+static const char *backup_path_of(const char *filepath, char *buf, size_t size) {
+    int len = snprintf(buf, size, "%s.backup", filepath);
+    return len < 0 || (size_t)len >= size ? NULL : buf;
+}
+
+static RetryStepResult file_access_step(void *arg, int attempt) {
+    const char *filepath = arg;
+    char backup_buf[PATH_MAX + 8];
+    const char *backup_path = backup_path_of(filepath, backup_buf, sizeof(backup_buf));
+    printf("Retry attempt %d...\n", attempt);
+    // The backup is only a partial recovery, so the file itself goes first
+    if (probe_cached(filepath, file_readable)) {
+        return (RetryStepResult)file_found(0);
+    }
+    if (backup_path && probe_cached(backup_path, file_readable)) {
+        return (RetryStepResult)file_found(1);
     }
-    return 0;
+    return RETRY_STEP_AGAIN;
 }
 
-RecoveryStatus recover_from_file_access_error(const char *filepath) {
+RecoveryStatus recover_from_file_access_error(const ErrorContext *context) {
+    RetryPolicy policy;
+    int attempts;
+    char path_buf[PATH_MAX];
+    char backup_buf[PATH_MAX + 8];
+    const char *filepath = context_resource(context, 0, path_buf, sizeof(path_buf));
+    if (filepath == NULL) {
+        printf("FILE_ACCESS_ERROR names no file; nothing to recover\n");
+        return RECOVERY_FAILED;
+    }
+    const char *paths[] = { filepath, backup_path_of(filepath, backup_buf, sizeof(backup_buf)) };
     printf("Attempting to recover from FILE_ACCESS_ERROR for %s...\n", filepath);
-    char backup_path[256];
-    snprintf(backup_path, sizeof(backup_path), "%s.backup", filepath);
-    for (int attempt = 1; attempt <= MAX_RETRIES; attempt++) {
-        printf("Retry attempt %d/%d...\n", attempt, MAX_RETRIES);
-        FILE *file = fopen(filepath, "r");
-        if (file != NULL) {
-            printf("Successfully accessed file on attempt %d\n", attempt);
-            fclose(file);
-            return RECOVERY_SUCCESS;
-        }
-        file = fopen(backup_path, "r");
-        if (file != NULL) {
-            printf("Successfully accessed backup file\n");
-            fclose(file);
-            return RECOVERY_PARTIAL;
-        }
-        sleep(RETRY_DELAY);
+    // A healthy result cached before the failure must not end recovery
+    probe_cache_invalidate(filepath);
+    context_policy(FILE_ACCESS_ERROR, context, &policy);
+
+    // Wait for the file or its backup to appear or become readable; when
+    // both are, file_watch_wait() returns the first, the file itself. A
+    // backup name too long for a path is skipped, not truncated.
+    int timeout_ms = context_timeout_ms(context, &policy);
+    int found = file_watch_wait(paths, paths[1] ? 2 : 1, timeout_ms, context_cancel(context));
+    if (found >= 0) {
+        return file_found(found);
+    }
+    if (errno == ETIMEDOUT) {
+        printf("Failed to recover: %s did not become readable within %d ms\n", filepath, timeout_ms);
+        return RECOVERY_FAILED;
+    }
+    if (errno == ECANCELED) {
+        printf("Recovery of %s was cancelled\n", filepath);
+        return RECOVERY_FAILED;
     }
-    printf("Failed to recover after %d attempts\n", MAX_RETRIES);
-    return RECOVERY_FAILED;
+
+    // The directory cannot be watched; fall back to retrying
+    RecoveryStatus status = retry_run_until(&policy, file_access_step, (void *)filepath, &attempts,
+                                            context_deadline(context), context_cancel(context));
+    if (status == RECOVERY_FAILED) {
+        printf("Failed to recover after %d attempts\n", attempts);
+    }
+    return status;
 }
 
 RecoveryStatus recover_from_memory_error(void) {
     printf("Attempting to recover from MEMORY_ERROR...\n");
     cleanup_resources();
+    reclaim_memory();
     if (!verify_system_resources()) {
         printf("System resources are still constrained\n");
         return RECOVERY_FAILED;
@@ -135,100 +212,354 @@ RecoveryStatus recover_from_null_error(void) {
     return RECOVERY_SUCCESS;
 }
 
-RecoveryStatus recover_from_device_error(void) {
+typedef struct {
+    const char *target;
+    const ErrorContext *context;
+} DeviceRecovery;
+
+static RetryStepResult device_step(void *arg, int attempt) {
+    const DeviceRecovery *recovery = arg;
+    const char *target = recovery->target;
+    char device[PATH_MAX];
+    int timeout_ms = deadline_timeout_ms(context_deadline(recovery->context), DEVICE_PROBE_TIMEOUT_MS);
+    printf("Probing %s (attempt %d)...\n", target ? target : "candidate devices", attempt);
+    switch (probe_devices(target, timeout_ms, context_cancel(recovery->context), device, sizeof(device))) {
+    case DEVICE_PROBE_ACCESSIBLE:
+        printf("Device %s is accessible\n", device);
+        return RETRY_STEP_SUCCESS;
+    case DEVICE_PROBE_RESET:
+        printf("Device %s reset successful\n", device);
+        return RETRY_STEP_SUCCESS;
+    default:
+        return RETRY_STEP_AGAIN;
+    }
+}
+
+RecoveryStatus recover_from_device_error(const ErrorContext *context) {
+    RetryPolicy policy;
+    char path_buf[PATH_MAX];
+    // Without a failing device, any working candidate will do
+    DeviceRecovery recovery = { context_resource(context, 1, path_buf, sizeof(path_buf)), context };
     printf("Attempting to recover from DEVICE_ERROR...\n");
-    const char *device_paths[] = {
-        "/dev/tty0",
-        "/dev/null",
-        "/dev/zero",
-        NULL
-    };
-    for (int i = 0; device_paths[i] != NULL; i++) {
-        for (int attempt = 1; attempt <= MAX_RETRIES; attempt++) {
-            printf("Attempting device reinitialization for %s (%d/%d)...\n", 
-                   device_paths[i], attempt, MAX_RETRIES);
-            if (check_device_status(device_paths[i])) {
-                printf("Device %s is accessible\n", device_paths[i]);
-                return RECOVERY_SUCCESS;
-            }
-            if (reset_device(device_paths[i])) {
-                printf("Device %s reset successful\n", device_paths[i]);
-                return RECOVERY_SUCCESS;
-            }
-            sleep(RETRY_DELAY);
-        }
+    if (recovery.target) {
+        probe_cache_invalidate(recovery.target);
     }
-    log_error(DEVICE_ERROR, "Failed to recover device after multiple attempts", errno);
-    return RECOVERY_FAILED;
+    context_policy(DEVICE_ERROR, context, &policy);
+    RecoveryStatus status = retry_run_until(&policy, device_step, &recovery, NULL, context_deadline(context),
+                                            context_cancel(context));
+    if (status == RECOVERY_FAILED) {
+        log_error(DEVICE_ERROR, "Failed to recover device after multiple attempts", errno);
+    }
+    return status;
 }
 
-RecoveryStatus recover_from_device_busy(void) {
-    printf("Attempting to recover from DEVICE_BUSY...\n");
-    for (int attempt = 1; attempt <= MAX_RETRIES; attempt++) {
-        printf("Waiting for device to become available (%d/%d)...\n", attempt, MAX_RETRIES);
-        double loadavg[1];
-        if (getloadavg(loadavg, 1) == 1 && loadavg[0] < 0.8) {
-            if (verify_system_resources()) {
-                printf("Device is now available\n");
-                return RECOVERY_SUCCESS;
-            }
+static RetryStepResult device_busy_step(void *arg, int attempt) {
+    const char *lockpath = arg;
+    printf("Waiting for %s to be unlocked (attempt %d)...\n", lockpath, attempt);
+    int fd = open(lockpath, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return RETRY_STEP_FAILED;
+    }
+    int locked = flock(fd, LOCK_EX | LOCK_NB) == 0;
+    if (locked) {
+        flock(fd, LOCK_UN);
+    }
+    close(fd);
+    return locked ? RETRY_STEP_SUCCESS : RETRY_STEP_AGAIN;
+}
+
+RecoveryStatus recover_from_device_busy(const ErrorContext *context) {
+    RetryPolicy policy;
+    LockHolder holder = { LOCK_KIND_FLOCK, 0, 1 };
+    char path_buf[PATH_MAX];
+    const char *lockpath = context_resource(context, 1, path_buf, sizeof(path_buf));
+    if (lockpath == NULL) {
+        printf("DEVICE_BUSY names no device or lock file; nothing to recover\n");
+        return RECOVERY_FAILED;
+    }
+    printf("Attempting to recover from DEVICE_BUSY for %s...\n", lockpath);
+    context_policy(DEVICE_BUSY, context, &policy);
+
+    if (find_lock_holder(lockpath, &holder) == 1) {
+        static const char *const kind_names[] = { "", "flock", "POSIX", "OFD" };
+        char message[256];
+        char owner[32] = "an open file description";   // OFD locks have no owning process
+        if (holder.pid > 0) {
+            snprintf(owner, sizeof(owner), "pid %d", (int)holder.pid);
         }
-        system("fuser -k /dev/busy_device 2>/dev/null");
-        sleep(RETRY_DELAY * 2);
+        snprintf(message, sizeof(message), "%s holds a %s %s lock on %s", owner, kind_names[holder.kind],
+                 holder.exclusive ? "write" : "read", lockpath);
+        printf("%s\n", message);
+        log_error(DEVICE_BUSY, message, EWOULDBLOCK);
+    }
+
+    // Block on the lock itself so recovery ends the moment it is released
+    int timeout_ms = context_timeout_ms(context, &policy);
+    if (wait_for_lock(lockpath, holder.kind, timeout_ms, context_cancel(context)) == 0) {
+        printf("Lock on %s was released\n", lockpath);
+        return RECOVERY_SUCCESS;
+    }
+    if (errno == ETIMEDOUT || errno == ECANCELED) {
+        log_error(DEVICE_BUSY, "Device remains busy after recovery attempts", errno);
+        return RECOVERY_FAILED;
+    }
+    if (errno != ENOTSUP) {
+        printf("Cannot wait for the lock on %s: %s\n", lockpath, strerror(errno));
+        return RECOVERY_FAILED;
+    }
+
+    // The wait could not be made interruptible; poll with backoff instead
+    RecoveryStatus status = retry_run_until(&policy, device_busy_step, (void *)lockpath, NULL,
+                                            context_deadline(context), context_cancel(context));
+    if (status == RECOVERY_FAILED) {
+        log_error(DEVICE_BUSY, "Device remains busy after recovery attempts", errno);
+    }
+    return status;
+}
+
+typedef struct {
+    PressureResource resource;
+    PressureSample last;
+} PressureCheck;
+
+// Pressure has eased once the stall share since the previous sample is
+// back under the trigger's threshold
+static RetryStepResult pressure_step(void *arg, int attempt) {
+    PressureCheck *check = arg;
+    PressureSample now;
+    if (pressure_sample(check->resource, &now) != 0) {
+        return RETRY_STEP_FAILED;
+    }
+    // Too short an interval says nothing; keep the older baseline
+    if (now.at_ns - check->last.at_ns < PRESSURE_MIN_SAMPLE_NS) {
+        return RETRY_STEP_AGAIN;
+    }
+    double stalled = pressure_stall_percent(&check->last, &now);
+    check->last = now;
+    printf("Pressure check %d: tasks stalled %.1f%% of the time\n", attempt, stalled);
+    return stalled < pressure_threshold(check->resource) ? RETRY_STEP_SUCCESS : RETRY_STEP_AGAIN;
+}
+
+RecoveryStatus recover_from_pressure(PressureResource resource, ErrorType type, const ErrorContext *context) {
+    RetryPolicy policy;
+    PressureCheck check = { .resource = resource };
+    printf("Waiting for resource pressure to ease...\n");
+    if (pressure_sample(resource, &check.last) != 0) {
+        return RECOVERY_FAILED;
+    }
+    context_policy(type, context, &policy);
+    RecoveryStatus status = retry_run_until(&policy, pressure_step, &check, NULL, context_deadline(context),
+                                            context_cancel(context));
+    if (status == RECOVERY_FAILED) {
+        log_error(type, "Resource pressure persists after recovery attempts", 0);
+    }
+    return status;
+}
+
+static RetryStepResult txt_busy_step(void *arg, int attempt) {
+    const char *filepath = arg;
+    (void)attempt;
+    printf("Checking file availability...\n");
+    int fd = open(filepath, O_RDWR | O_NONBLOCK);
+    if (fd != -1) {
+        printf("File is now available\n");
+        close(fd);
+        return RETRY_STEP_SUCCESS;
+    }
+    if (errno != ETXTBSY) {
+        printf("Unexpected error: %s\n", strerror(errno));
+        return RETRY_STEP_FAILED;
+    }
+    return RETRY_STEP_AGAIN;
+}
+
+static void log_txt_busy_holders(const char *filepath, const pid_t *pids, int count) {
+    char message[512];
+    int len = snprintf(message, sizeof(message), "%s is being executed by pid", filepath);
+    for (int i = 0; i < count && len > 0 && (size_t)len < sizeof(message); i++) {
+        len += snprintf(message + len, sizeof(message) - (size_t)len, " %d", (int)pids[i]);
     }
-    log_error(DEVICE_BUSY, "Device remains busy after recovery attempts", errno);
-    return RECOVERY_FAILED;
+    printf("%s\n", message);
+    log_error(TXT_BUSY, message, ETXTBSY);
 }
 
-RecoveryStatus recover_from_txt_busy(const char *filepath) {
+RecoveryStatus recover_from_txt_busy(const ErrorContext *context) {
+    RetryPolicy policy;
+    pid_t holders[TXT_BUSY_MAX_HOLDERS];
+    struct timespec start, now;
+    char path_buf[PATH_MAX];
+    const char *filepath = context_resource(context, 0, path_buf, sizeof(path_buf));
+    if (filepath == NULL) {
+        printf("TXT_BUSY names no file; nothing to recover\n");
+        return RECOVERY_FAILED;
+    }
     printf("Attempting to recover from TXT_BUSY for %s...\n", filepath);
-    for (int attempt = 1; attempt <= MAX_RETRIES; attempt++) {
-        printf("Checking file availability (%d/%d)...\n", attempt, MAX_RETRIES);
-        int fd = open(filepath, O_RDWR | O_NONBLOCK);
-        if (fd != -1) {
-            printf("File is now available\n");
-            close(fd);
-            return RECOVERY_SUCCESS;
+    context_policy(TXT_BUSY, context, &policy);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Wait for the processes executing the file to exit; new ones may start
+    // meanwhile, so check again after each round
+    for (int attempt = 1;; attempt++) {
+        RetryStepResult result = txt_busy_step((void *)filepath, attempt);
+        if (result != RETRY_STEP_AGAIN) {
+            return (RecoveryStatus)result;
+        }
+        int count = find_file_executors(filepath, holders, TXT_BUSY_MAX_HOLDERS);
+        if (count <= 0) {
+            // Nothing visible to wait for (e.g. holders in another PID namespace)
+            return retry_run_until(&policy, txt_busy_step, (void *)filepath, NULL, context_deadline(context),
+                                   context_cancel(context));
+        }
+        if (policy.max_attempts > 0 && attempt >= policy.max_attempts) {
+            printf("File %s is still busy after %d attempts\n", filepath, attempt);
+            return RECOVERY_FAILED;
+        }
+        log_txt_busy_holders(filepath, holders, count);
+
+        int timeout_ms = -1;
+        if (policy.max_elapsed_ms > 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long spent = (long)(now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+            if (spent >= (long)policy.max_elapsed_ms) {
+                printf("File %s is still busy\n", filepath);
+                return RECOVERY_FAILED;
+            }
+            timeout_ms = (int)(policy.max_elapsed_ms - (unsigned long)spent);
         }
-        if (errno != ETXTBSY) {
-            printf("Unexpected error: %s\n", strerror(errno));
+        timeout_ms = deadline_timeout_ms(context_deadline(context), timeout_ms);
+        if (timeout_ms == 0 || wait_for_pids_exit(holders, count, timeout_ms, context_cancel(context)) != 0) {
+            printf("File %s is still busy\n", filepath);
             return RECOVERY_FAILED;
         }
-        sleep(RETRY_DELAY);
     }
-    return RECOVERY_FAILED;
 }
 
-RecoveryStatus recover_from_error(ErrorType type) {
+// The event's context, or one built from the resource it names
+static const ErrorContext *event_context(const ErrorEvent *event, ErrorContext *scratch) {
+    if (event->context) {
+        return event->context;
+    }
+    *scratch = (ErrorContext)ERROR_CONTEXT_INIT;
+    scratch->path = event->resource;
+    scratch->device = event->resource;
+    return scratch;
+}
+
+static RecoveryStatus file_access_handler(const ErrorEvent *event, void *user_data) {
+    ErrorContext scratch;
+    (void)user_data;
+    return recover_from_file_access_error(event_context(event, &scratch));
+}
+
+static RecoveryStatus memory_handler(const ErrorEvent *event, void *user_data) {
+    (void)event;
+    (void)user_data;
+    return recover_from_memory_error();
+}
+
+static RecoveryStatus device_handler(const ErrorEvent *event, void *user_data) {
+    ErrorContext scratch;
+    (void)user_data;
+    return recover_from_device_error(event_context(event, &scratch));
+}
+
+static RecoveryStatus null_handler(const ErrorEvent *event, void *user_data) {
+    (void)event;
+    (void)user_data;
+    return recover_from_null_error();
+}
+
+static RecoveryStatus txt_busy_handler(const ErrorEvent *event, void *user_data) {
+    ErrorContext scratch;
+    (void)user_data;
+    return recover_from_txt_busy(event_context(event, &scratch));
+}
+
+static RecoveryStatus device_busy_handler(const ErrorEvent *event, void *user_data) {
+    ErrorContext scratch;
+    (void)user_data;
+    return recover_from_device_busy(event_context(event, &scratch));
+}
+
+void register_builtin_recoveries(void) {
+    register_error_handler(MEMORY_ERROR, HANDLER_STAGE_RECOVER, memory_handler, NULL);
+    register_error_handler(FILE_ACCESS_ERROR, HANDLER_STAGE_RECOVER, file_access_handler, NULL);
+    register_error_handler(DEVICE_ERROR, HANDLER_STAGE_RECOVER, device_handler, NULL);
+    register_error_handler(NULL_ERROR, HANDLER_STAGE_RECOVER, null_handler, NULL);
+    register_error_handler(TXT_BUSY, HANDLER_STAGE_RECOVER, txt_busy_handler, NULL);
+    register_error_handler(DEVICE_BUSY, HANDLER_STAGE_RECOVER, device_busy_handler, NULL);
+}
+
+static __thread RecoveryReason failure_reason;
+
+RecoveryReason recovery_failure_reason(void) {
+    return failure_reason;
+}
+
+const char *recovery_reason_string(RecoveryReason reason) {
+    switch (reason) {
+    case RECOVERY_REASON_NONE:
+        return "none";
+    case RECOVERY_REASON_FAILED:
+        return "failed";
+    case RECOVERY_REASON_DEADLINE_EXCEEDED:
+        return "deadline exceeded";
+    case RECOVERY_REASON_CANCELLED:
+        return "cancelled";
+    }
+    return "unknown";
+}
+
+static RecoveryStatus run_recovery_chain(void *arg) {
+    const ErrorEvent *event = arg;
+    RecoveryStatus status = run_error_handlers(event, HANDLER_STAGE_RECOVER, NULL);
+    // A caller that gave up is waiting on us; leave cleanup to a later failure
+    if (status == RECOVERY_FAILED && context_stopped(event->context) == 0) {
+        cleanup_resources();
+    }
+    return status;
+}
+
+RecoveryStatus recover_from_event(const ErrorEvent *event) {
+    const ErrorContext *context = event->context;
     RecoveryStatus status = RECOVERY_FAILED;
-    switch(type) {
-        case MEMORY_ERROR:
-            status = recover_from_memory_error();
-            break;
-        case FILE_ACCESS_ERROR:
-            status = recover_from_file_access_error("/path/to/nonexistent/file.txt");
-            break;
-        case DEVICE_ERROR:
-            status = recover_from_device_error();
-            break;
-        case NULL_ERROR:
-            status = recover_from_null_error();
-            break;
-        case TXT_BUSY:
-            status = recover_from_txt_busy("example.lock");
-            break;
-        case DEVICE_BUSY:
-            status = recover_from_device_busy();
-            break;
-        default:
-            printf("Unknown error type. Unable to recover.\n");
-            return RECOVERY_FAILED;
+    if (count_error_handlers(event->type, HANDLER_STAGE_RECOVER) == 0) {
+        printf("Unknown error type. Unable to recover.\n");
+        failure_reason = RECOVERY_REASON_FAILED;
+        return RECOVERY_FAILED;
+    }
+    // Nothing to do if the caller has already given up; otherwise concurrent
+    // failures of the same kind share one recovery attempt
+    if (context_stopped(context) == 0) {
+        status = run_recovery_once(event->type, event->resource, run_recovery_chain, (void *)event,
+                                   context_deadline(context), context_cancel(context));
+    }
+    if (status != RECOVERY_FAILED) {
+        failure_reason = RECOVERY_REASON_NONE;
+    } else {
+        int stopped = context_stopped(context);
+        failure_reason = stopped == ECANCELED ? RECOVERY_REASON_CANCELLED :
+                         stopped == ETIMEDOUT ? RECOVERY_REASON_DEADLINE_EXCEEDED : RECOVERY_REASON_FAILED;
+    }
+    if (failure_reason > RECOVERY_REASON_FAILED) {
+        printf("Recovery failed for error type %d: %s\n", event->type, recovery_reason_string(failure_reason));
+        return status;
     }
     const char *status_str = (status == RECOVERY_SUCCESS) ? "successful" :
                            (status == RECOVERY_PARTIAL) ? "partial" : "failed";
-    printf("Recovery %s for error type %d\n", status_str, type);
-    if (status == RECOVERY_FAILED) {
-        cleanup_resources();
-    }
+    printf("Recovery %s for error type %d\n", status_str, event->type);
     return status;
 }
+
+RecoveryStatus recover_from_error_ctx(ErrorType type, const ErrorContext *context) {
+    ErrorEvent event = { .type = type, .message = NULL, .error_code = 0, .context = context };
+    if (context) {
+        event.resource = context->path ? context->path : context->device;
+    }
+    error_handler_init();
+    return recover_from_event(&event);
+}
+
+RecoveryStatus recover_from_error(ErrorType type) {
+    return recover_from_error_ctx(type, NULL);
+}
@@ -3,6 +3,7 @@
 #define RECOVERY_H
 
 #include "error_handler.h"
+#include "pressure_monitor.h"
 
 // Recovery status enum
 typedef enum {
@@ -11,16 +12,45 @@ typedef enum {
     RECOVERY_FAILED
 } RecoveryStatus;
 
-// Main recovery function
+// Why the last recovery on this thread returned RECOVERY_FAILED
+typedef enum {
+    RECOVERY_REASON_NONE,               // It did not fail
+    RECOVERY_REASON_FAILED,             // Every strategy was tried
+    RECOVERY_REASON_DEADLINE_EXCEEDED,  // The context's deadline_ns passed first
+    RECOVERY_REASON_CANCELLED           // The context's cancel token was cancelled
+} RecoveryReason;
+
+// Main recovery function. Without a context, recoveries that need a file
+// or device have nothing to act on and fail at once.
 RecoveryStatus recover_from_error(ErrorType type);
 
-// Specific recovery functions
-RecoveryStatus recover_from_file_access_error(const char *filepath);
+// Recover from type for the resource and attempt budget in context. Every
+// wait ends at context->deadline_ns or when context->cancel is cancelled,
+// and recovery then returns RECOVERY_FAILED; see recovery_failure_reason().
+RecoveryStatus recover_from_error_ctx(ErrorType type, const ErrorContext *context);
+
+// Run the registered recovery chain for event; cleans up resources if it fails
+RecoveryStatus recover_from_event(const ErrorEvent *event);
+
+// Reason for the last recover_from_event() result on the calling thread,
+// so a request can tell a missed deadline from a resource that stayed broken
+RecoveryReason recovery_failure_reason(void);
+const char *recovery_reason_string(RecoveryReason reason);
+
+// Register the built-in recover_from_* handlers (done by error_handler_init())
+void register_builtin_recoveries(void);
+
+// Specific recovery functions. Those taking a context act on its path
+// (file errors) or device (device errors), falling back to the other field
+// and then to what context->fd refers to. context may be NULL; only device
+// recovery has something to try then, the configured candidates.
+RecoveryStatus recover_from_file_access_error(const ErrorContext *context);
 RecoveryStatus recover_from_memory_error(void);
 RecoveryStatus recover_from_null_error(void);
-RecoveryStatus recover_from_device_error(void);
-RecoveryStatus recover_from_device_busy(void);
-RecoveryStatus recover_from_txt_busy(const char *filepath);
+RecoveryStatus recover_from_device_error(const ErrorContext *context);
+RecoveryStatus recover_from_device_busy(const ErrorContext *context);
+RecoveryStatus recover_from_txt_busy(const ErrorContext *context);
+RecoveryStatus recover_from_pressure(PressureResource resource, ErrorType type, const ErrorContext *context);
 
 // Recovery utility functions
 void cleanup_resources(void);
@@ -0,0 +1,194 @@
+// File: src/recovery_guard.c
+#include "recovery_guard.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#define RESOURCE_KEY_SIZE 256
+
+typedef struct InFlight {
+    struct InFlight *next;
+    ErrorType type;
+    char resource[RESOURCE_KEY_SIZE];
+    int refs;
+    int running;   // A caller is running fn for the entry
+    int done;
+    RecoveryStatus status;
+} InFlight;
+
+static pthread_mutex_t guard_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t guard_once = PTHREAD_ONCE_INIT;
+static pthread_cond_t guard_cond;
+static InFlight *in_flight;
+
+static int bulkhead_limit[RESOURCE_CLASS_COUNT] = {
+    [RESOURCE_CLASS_MEMORY] = 1,   // Memory recovery acts on the whole process
+    [RESOURCE_CLASS_FILE] = 4,
+    [RESOURCE_CLASS_DEVICE] = 2,
+    [RESOURCE_CLASS_OTHER] = 2,
+};
+static int bulkhead_active[RESOURCE_CLASS_COUNT];
+
+static const unsigned char class_of_type[ERROR_TYPE_COUNT] = {
+    [MEMORY_ERROR] = RESOURCE_CLASS_MEMORY,
+    [NULL_ERROR] = RESOURCE_CLASS_MEMORY,
+    [FILE_ACCESS_ERROR] = RESOURCE_CLASS_FILE,
+    [INVALID_ARGUMENT] = RESOURCE_CLASS_FILE,
+    [BAD_FILE_DESCRIPTOR] = RESOURCE_CLASS_FILE,
+    [TXT_BUSY] = RESOURCE_CLASS_FILE,
+    [DEVICE_ERROR] = RESOURCE_CLASS_DEVICE,
+    [WRONG_DEVICE_COMMAND] = RESOURCE_CLASS_DEVICE,
+    [DEVICE_ERROR_ACCESS_FAILURE] = RESOURCE_CLASS_DEVICE,
+    [DEVICE_BUSY] = RESOURCE_CLASS_DEVICE,
+    [UNKNOWN_ERROR] = RESOURCE_CLASS_OTHER,
+};
+
+// Deadlines are CLOCK_MONOTONIC, so the condition variable must be too
+static void init_guard_cond(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&guard_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Wait on guard_cond with guard_mutex held. Returns 0 when woken, or
+// ETIMEDOUT/ECANCELED once the caller should stop waiting.
+static int guard_wait(unsigned long long deadline_ns, CancelToken *cancel) {
+    if (cancel_token_cancelled(cancel)) {
+        return ECANCELED;
+    }
+    if (deadline_ns == 0) {
+        pthread_cond_wait(&guard_cond, &guard_mutex);
+        return 0;
+    }
+    struct timespec until = { (time_t)(deadline_ns / 1000000000ULL), (long)(deadline_ns % 1000000000ULL) };
+    return pthread_cond_timedwait(&guard_cond, &guard_mutex, &until) == ETIMEDOUT ? ETIMEDOUT : 0;
+}
+
+ResourceClass resource_class_of(ErrorType type) {
+    if ((unsigned)type >= ERROR_TYPE_COUNT) {
+        return RESOURCE_CLASS_OTHER;
+    }
+    return (ResourceClass)class_of_type[type];
+}
+
+void set_bulkhead_limit(ResourceClass resource_class, int max_concurrent) {
+    if ((unsigned)resource_class >= RESOURCE_CLASS_COUNT) {
+        return;
+    }
+    pthread_once(&guard_once, init_guard_cond);
+    pthread_mutex_lock(&guard_mutex);
+    bulkhead_limit[resource_class] = max_concurrent < 1 ? 1 : max_concurrent;
+    pthread_cond_broadcast(&guard_cond);
+    pthread_mutex_unlock(&guard_mutex);
+}
+
+static InFlight *find_in_flight(ErrorType type, const char *resource) {
+    for (InFlight *entry = in_flight; entry != NULL; entry = entry->next) {
+        if (entry->type == type && strcmp(entry->resource, resource) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void unlink_in_flight(InFlight *entry) {
+    for (InFlight **link = &in_flight; *link != NULL; link = &(*link)->next) {
+        if (*link == entry) {
+            *link = entry->next;
+            break;
+        }
+    }
+}
+
+static void release_in_flight(InFlight *entry) {
+    if (--entry->refs == 0) {
+        unlink_in_flight(entry);
+        free(entry);
+    }
+}
+
+static int caller_stopped(unsigned long long deadline_ns, CancelToken *cancel) {
+    return cancel_token_cancelled(cancel) || deadline_passed(deadline_ns);
+}
+
+RecoveryStatus run_recovery_once(ErrorType type, const char *resource, RecoveryFn fn, void *arg,
+                                 unsigned long long deadline_ns, CancelToken *cancel) {
+    ResourceClass resource_class = resource_class_of(type);
+    RecoveryStatus status = RECOVERY_FAILED;
+    CancelWatch watch;
+    if (resource == NULL) {
+        resource = "";
+    }
+    pthread_once(&guard_once, init_guard_cond);
+    cancel_token_watch(cancel, &watch, &guard_mutex, &guard_cond);
+
+    pthread_mutex_lock(&guard_mutex);
+    InFlight *entry = find_in_flight(type, resource);
+    if (entry) {
+        entry->refs++;
+    } else if ((entry = calloc(1, sizeof(InFlight))) != NULL) {
+        entry->type = type;
+        snprintf(entry->resource, sizeof(entry->resource), "%s", resource);
+        entry->refs = 1;
+        entry->next = in_flight;
+        in_flight = entry;
+    } else {
+        // Cannot track it; still respect the bulkhead
+        int gave_up = 0;
+        while (!gave_up && bulkhead_active[resource_class] >= bulkhead_limit[resource_class]) {
+            gave_up = guard_wait(deadline_ns, cancel) != 0;
+        }
+        if (!gave_up) {
+            bulkhead_active[resource_class]++;
+            pthread_mutex_unlock(&guard_mutex);
+            status = fn(arg);
+            pthread_mutex_lock(&guard_mutex);
+            bulkhead_active[resource_class]--;
+            pthread_cond_broadcast(&guard_cond);
+        }
+        pthread_mutex_unlock(&guard_mutex);
+        cancel_token_unwatch(cancel, &watch);
+        return status;
+    }
+
+    // Share the result of whoever runs the recovery. When nobody is running
+    // it and a bulkhead slot is free, run it with this caller's own limits.
+    for (;;) {
+        if (entry->done) {
+            status = entry->status;
+            break;
+        }
+        if (!entry->running && bulkhead_active[resource_class] < bulkhead_limit[resource_class]) {
+            entry->running = 1;
+            bulkhead_active[resource_class]++;
+            pthread_mutex_unlock(&guard_mutex);
+            status = fn(arg);
+            pthread_mutex_lock(&guard_mutex);
+            bulkhead_active[resource_class]--;
+            entry->running = 0;
+            if (status != RECOVERY_FAILED || !caller_stopped(deadline_ns, cancel)) {
+                // A real verdict: new callers start afresh, waiters share it
+                entry->status = status;
+                entry->done = 1;
+                unlink_in_flight(entry);
+            }
+            // Otherwise only this caller ran out of time or was cancelled;
+            // a waiter with time left takes the run over
+            pthread_cond_broadcast(&guard_cond);
+            break;
+        }
+        if (guard_wait(deadline_ns, cancel) != 0) {
+            status = RECOVERY_FAILED;
+            break;
+        }
+    }
+    release_in_flight(entry);
+    pthread_mutex_unlock(&guard_mutex);
+    cancel_token_unwatch(cancel, &watch);
+    return status;
+}
@@ -0,0 +1,35 @@
+// File: src/recovery_guard.h
+#ifndef RECOVERY_GUARD_H
+#define RECOVERY_GUARD_H
+
+#include "error_handler.h"
+#include "recovery.h"
+#include "cancel.h"
+
+// Recoveries are capped per class of resource they act on
+typedef enum {
+    RESOURCE_CLASS_MEMORY,
+    RESOURCE_CLASS_FILE,
+    RESOURCE_CLASS_DEVICE,
+    RESOURCE_CLASS_OTHER,
+    RESOURCE_CLASS_COUNT
+} ResourceClass;
+
+typedef RecoveryStatus (*RecoveryFn)(void *arg);
+
+ResourceClass resource_class_of(ErrorType type);
+
+// Maximum number of recoveries of one class running at once (minimum 1)
+void set_bulkhead_limit(ResourceClass resource_class, int max_concurrent);
+
+// Run fn once for all concurrent callers with the same type and resource
+// (NULL means the whole type). Callers that arrive while it is running wait
+// and receive the same status. The run itself waits for a bulkhead slot.
+// fn runs with the limits of the caller that runs it. A caller whose
+// deadline_ns (CLOCK_MONOTONIC, 0 = none) passes or whose cancel (optional)
+// is cancelled gets RECOVERY_FAILED. If that cuts its own run short, the
+// failure is not shared: a waiting caller runs fn again with its own limits.
+RecoveryStatus run_recovery_once(ErrorType type, const char *resource, RecoveryFn fn, void *arg,
+                                 unsigned long long deadline_ns, CancelToken *cancel);
+
+#endif // RECOVERY_GUARD_H
@@ -0,0 +1,438 @@
+// File: src/resource_registry.c
+#define _GNU_SOURCE
+#include "resource_registry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/sem.h>
+#include <sys/msg.h>
+
+#define TEMP_DIR "/tmp"
+#define TEMP_PREFIX "error_handler_"
+
+#ifndef SYS_close_range
+#define SYS_close_range 436
+#endif
+
+typedef struct {
+    int *fds;
+    size_t count;
+    size_t capacity;
+} FdSet;
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t mode_once = PTHREAD_ONCE_INIT;
+static FdSet owned_fds;
+static FdSet protected_fds;
+static FdCleanupMode cleanup_mode = FD_CLEANUP_OWNED;
+
+typedef struct {
+    OwnedIpcKind kind;
+    int id;
+} OwnedIpc;
+
+typedef struct {
+    char dir[PATH_MAX];
+    char name[NAME_MAX + 1];
+} OwnedTempFile;
+
+static OwnedIpc *owned_ipc;
+static size_t owned_ipc_count;
+static size_t owned_ipc_capacity;
+static OwnedTempFile *owned_temp_files;
+static size_t owned_temp_count;
+static size_t owned_temp_capacity;
+
+static void read_mode_from_env(void) {
+    const char *mode = getenv("EH_FD_CLEANUP");
+    if (mode && strcmp(mode, "all") == 0) {
+        cleanup_mode = FD_CLEANUP_ALL;
+    }
+}
+
+static int fd_set_add(FdSet *set, int fd) {
+    for (size_t i = 0; i < set->count; i++) {
+        if (set->fds[i] == fd) {
+            return 0;
+        }
+    }
+    if (set->count == set->capacity) {
+        size_t capacity = set->capacity ? set->capacity * 2 : 16;
+        int *fds = realloc(set->fds, capacity * sizeof(*fds));
+        if (fds == NULL) {
+            return -1;
+        }
+        set->fds = fds;
+        set->capacity = capacity;
+    }
+    set->fds[set->count++] = fd;
+    return 0;
+}
+
+static void fd_set_remove(FdSet *set, int fd) {
+    for (size_t i = 0; i < set->count; i++) {
+        if (set->fds[i] == fd) {
+            set->fds[i] = set->fds[--set->count];
+            return;
+        }
+    }
+}
+
+static int fd_set_has(const FdSet *set, int fd) {
+    for (size_t i = 0; i < set->count; i++) {
+        if (set->fds[i] == fd) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int update_set(FdSet *set, int fd, int add) {
+    int rc = 0;
+    if (fd < 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&registry_mutex);
+    if (add) {
+        rc = fd_set_add(set, fd);
+    } else {
+        fd_set_remove(set, fd);
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    return rc;
+}
+
+int register_owned_fd(int fd) {
+    return update_set(&owned_fds, fd, 1);
+}
+
+void unregister_owned_fd(int fd) {
+    update_set(&owned_fds, fd, 0);
+}
+
+int protect_fd(int fd) {
+    return update_set(&protected_fds, fd, 1);
+}
+
+void unprotect_fd(int fd) {
+    update_set(&protected_fds, fd, 0);
+}
+
+void set_fd_cleanup_mode(FdCleanupMode mode) {
+    pthread_once(&mode_once, read_mode_from_env);
+    pthread_mutex_lock(&registry_mutex);
+    cleanup_mode = mode;
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+static int compare_fds(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Without close_range() (Linux < 5.9), close what /proc/self/fd lists
+static int close_unprotected_by_listing(void) {
+    int fds[256];
+    int closed = 0;
+    int found;
+    do {
+        DIR *dir = opendir("/proc/self/fd");
+        if (dir == NULL) {
+            return closed;
+        }
+        found = 0;
+        struct dirent *entry;
+        while (found < (int)(sizeof(fds) / sizeof(fds[0])) && (entry = readdir(dir)) != NULL) {
+            int fd = atoi(entry->d_name);
+            if (entry->d_name[0] != '.' && fd > 2 && fd != dirfd(dir) && !fd_set_has(&protected_fds, fd)) {
+                fds[found++] = fd;
+            }
+        }
+        closedir(dir);
+        for (int i = 0; i < found; i++) {
+            close(fds[i]);
+        }
+        closed += found;
+    } while (found == (int)(sizeof(fds) / sizeof(fds[0])));
+    return closed;
+}
+
+// How many descriptors from 3 up are open and not protected
+static int count_unprotected(void) {
+    int count = 0;
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir == NULL) {
+        return 0;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int fd = atoi(entry->d_name);
+        if (entry->d_name[0] != '.' && fd > 2 && fd != dirfd(dir) && !fd_set_has(&protected_fds, fd)) {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+// Close everything from 3 up in the gaps between protected descriptors.
+// Returns the number of descriptors closed, counted beforehand.
+static int close_unprotected(void) {
+    unsigned int low = 3;
+    int closing = count_unprotected();
+    qsort(protected_fds.fds, protected_fds.count, sizeof(int), compare_fds);
+    for (size_t i = 0; i <= protected_fds.count; i++) {
+        unsigned int high = i < protected_fds.count ? (unsigned int)protected_fds.fds[i] : ~0U;
+        if (high < low) {
+            continue;
+        }
+        if (high > low && syscall(SYS_close_range, low, high == ~0U ? ~0U : high - 1, 0) != 0) {
+            return errno == ENOSYS ? close_unprotected_by_listing() : closing;
+        }
+        if (high == ~0U) {
+            break;
+        }
+        low = high + 1;
+    }
+    return closing;
+}
+
+int cleanup_fds(void) {
+    int closed = 0;
+    pthread_once(&mode_once, read_mode_from_env);
+    pthread_mutex_lock(&registry_mutex);
+    if (cleanup_mode == FD_CLEANUP_ALL) {
+        closed = close_unprotected();
+        owned_fds.count = 0;
+    } else {
+        for (size_t i = 0; i < owned_fds.count; i++) {
+            if (!fd_set_has(&protected_fds, owned_fds.fds[i]) && close(owned_fds.fds[i]) == 0) {
+                closed++;
+            }
+        }
+        owned_fds.count = 0;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    return closed;
+}
+
+// Grow *array to hold one more element of elem_size bytes
+static int reserve_one(void **array, size_t count, size_t *capacity, size_t elem_size) {
+    if (count < *capacity) {
+        return 0;
+    }
+    size_t new_capacity = *capacity ? *capacity * 2 : 16;
+    void *grown = realloc(*array, new_capacity * elem_size);
+    if (grown == NULL) {
+        return -1;
+    }
+    *array = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+int register_owned_ipc(OwnedIpcKind kind, int id) {
+    int rc = 0;
+    if (id < 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&registry_mutex);
+    if (reserve_one((void **)&owned_ipc, owned_ipc_count, &owned_ipc_capacity, sizeof(*owned_ipc)) == 0) {
+        owned_ipc[owned_ipc_count++] = (OwnedIpc){ kind, id };
+    } else {
+        rc = -1;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    return rc;
+}
+
+void unregister_owned_ipc(OwnedIpcKind kind, int id) {
+    pthread_mutex_lock(&registry_mutex);
+    for (size_t i = 0; i < owned_ipc_count; i++) {
+        if (owned_ipc[i].kind == kind && owned_ipc[i].id == id) {
+            owned_ipc[i] = owned_ipc[--owned_ipc_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+int cleanup_ipc(void) {
+    int removed = 0;
+    pthread_mutex_lock(&registry_mutex);
+    for (size_t i = 0; i < owned_ipc_count; i++) {
+        int rc = -1;
+        switch (owned_ipc[i].kind) {
+        case OWNED_IPC_SHM:
+            rc = shmctl(owned_ipc[i].id, IPC_RMID, NULL);
+            break;
+        case OWNED_IPC_SEM:
+            rc = semctl(owned_ipc[i].id, 0, IPC_RMID);
+            break;
+        case OWNED_IPC_MSG:
+            rc = msgctl(owned_ipc[i].id, IPC_RMID, NULL);
+            break;
+        }
+        if (rc == 0) {
+            removed++;
+        }
+    }
+    owned_ipc_count = 0;
+    pthread_mutex_unlock(&registry_mutex);
+    return removed;
+}
+
+static int split_path(const char *path, OwnedTempFile *file) {
+    const char *slash = strrchr(path, '/');
+    const char *name = slash ? slash + 1 : path;
+    int dir_len = slash ? (int)(slash - path) : 0;
+    if (*name == '\0' || strlen(name) > NAME_MAX || dir_len >= PATH_MAX) {
+        return -1;
+    }
+    if (slash == NULL) {
+        snprintf(file->dir, sizeof(file->dir), ".");
+    } else if (dir_len == 0) {
+        snprintf(file->dir, sizeof(file->dir), "/");
+    } else {
+        snprintf(file->dir, sizeof(file->dir), "%.*s", dir_len, path);
+    }
+    snprintf(file->name, sizeof(file->name), "%s", name);
+    return 0;
+}
+
+int register_owned_temp_file(const char *path) {
+    OwnedTempFile file;
+    int rc = 0;
+    if (path == NULL || split_path(path, &file) != 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&registry_mutex);
+    if (reserve_one((void **)&owned_temp_files, owned_temp_count, &owned_temp_capacity,
+                    sizeof(*owned_temp_files)) == 0) {
+        owned_temp_files[owned_temp_count++] = file;
+    } else {
+        rc = -1;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    return rc;
+}
+
+void unregister_owned_temp_file(const char *path) {
+    OwnedTempFile file;
+    if (path == NULL || split_path(path, &file) != 0) {
+        return;
+    }
+    pthread_mutex_lock(&registry_mutex);
+    for (size_t i = 0; i < owned_temp_count; i++) {
+        if (strcmp(owned_temp_files[i].dir, file.dir) == 0 && strcmp(owned_temp_files[i].name, file.name) == 0) {
+            owned_temp_files[i] = owned_temp_files[--owned_temp_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+int create_owned_temp_file(char *path, size_t size) {
+    // The pid in the name lets a later sweep tell leftovers from live files
+    if (snprintf(path, size, "%s/%s%d_XXXXXX", TEMP_DIR, TEMP_PREFIX, (int)getpid()) >= (int)size) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = mkostemp(path, O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    if (register_owned_temp_file(path) != 0) {
+        unlink(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Pid of the process that created name with create_owned_temp_file(), if
+// that process has exited; 0 for names of live processes or other formats
+static pid_t dead_creator(const char *name) {
+    char *end;
+    const char *digits = name + sizeof(TEMP_PREFIX) - 1;
+    long pid = strtol(digits, &end, 10);
+    if (end == digits || *end != '_' || pid <= 0 || pid == getpid()) {
+        return 0;
+    }
+    return kill((pid_t)pid, 0) == -1 && errno == ESRCH ? (pid_t)pid : 0;
+}
+
+// Remove temp files that processes of ours created and left behind when
+// they died. Files of live processes, ours included, are never touched:
+// they may still be in use, or deliberately unregistered.
+static int sweep_temp_dir(int dir_fd) {
+    int removed = 0;
+    int list_fd = openat(dir_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = list_fd == -1 ? NULL : fdopendir(list_fd);
+    if (dir == NULL) {
+        if (list_fd != -1) {
+            close(list_fd);
+        }
+        return 0;
+    }
+    uid_t uid = geteuid();
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat st;
+        if (strncmp(entry->d_name, TEMP_PREFIX, sizeof(TEMP_PREFIX) - 1) != 0 ||
+            fstatat(dir_fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 ||
+            !S_ISREG(st.st_mode) || st.st_uid != uid || dead_creator(entry->d_name) == 0) {
+            continue;
+        }
+        if (unlinkat(dir_fd, entry->d_name, 0) == 0) {
+            removed++;
+        }
+    }
+    closedir(dir);
+    return removed;
+}
+
+int cleanup_temp_files(void) {
+    int removed = 0;
+    int dir_fd = -1;
+    const char *open_dir = NULL;
+
+    pthread_mutex_lock(&registry_mutex);
+    for (size_t i = 0; i < owned_temp_count; i++) {
+        // Files are usually in one directory; reopen only when it changes
+        if (open_dir == NULL || strcmp(open_dir, owned_temp_files[i].dir) != 0) {
+            if (dir_fd != -1) {
+                close(dir_fd);
+            }
+            open_dir = owned_temp_files[i].dir;
+            dir_fd = open(open_dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+        }
+        if (dir_fd != -1 && unlinkat(dir_fd, owned_temp_files[i].name, 0) == 0) {
+            removed++;
+        }
+    }
+    owned_temp_count = 0;
+    pthread_mutex_unlock(&registry_mutex);
+    if (dir_fd != -1) {
+        close(dir_fd);
+    }
+
+    dir_fd = open(TEMP_DIR, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd != -1) {
+        removed += sweep_temp_dir(dir_fd);
+        close(dir_fd);
+    }
+    return removed;
+}
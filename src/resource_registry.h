@@ -0,0 +1,62 @@
+// File: src/resource_registry.h
+#ifndef RESOURCE_REGISTRY_H
+#define RESOURCE_REGISTRY_H
+
+#include <stddef.h>
+
+// What cleanup_resources() may close
+typedef enum {
+    FD_CLEANUP_OWNED,   // Only descriptors registered with register_owned_fd() (default)
+    FD_CLEANUP_ALL      // Every descriptor from 3 up, with close_range(), except protected ones
+} FdCleanupMode;
+
+// Hand a descriptor to the error handler: it is closed by the next cleanup.
+// Returns 0, or -1 on bad fd or ENOMEM.
+int register_owned_fd(int fd);
+
+// Take a descriptor back, e.g. before closing it yourself
+void unregister_owned_fd(int fd);
+
+// Mark a descriptor the process depends on (a connection, a log file, the
+// library's own watches) so no cleanup mode ever closes it
+int protect_fd(int fd);
+void unprotect_fd(int fd);
+
+// Also set with EH_FD_CLEANUP=owned|all
+void set_fd_cleanup_mode(FdCleanupMode mode);
+
+// Close descriptors according to the cleanup mode. Returns how many were
+// closed. The library protects every descriptor it holds open, including
+// short-lived ones such as cancel-token eventfds, inotify and pidfd waits.
+int cleanup_fds(void);
+
+typedef enum {
+    OWNED_IPC_SHM,
+    OWNED_IPC_SEM,
+    OWNED_IPC_MSG
+} OwnedIpcKind;
+
+// System V IPC objects to remove on cleanup. Only these are removed;
+// other IPC objects of the same user are left alone.
+int register_owned_ipc(OwnedIpcKind kind, int id);
+void unregister_owned_ipc(OwnedIpcKind kind, int id);
+
+// Remove the registered IPC objects with shmctl()/semctl()/msgctl(IPC_RMID).
+// Returns the number removed.
+int cleanup_ipc(void);
+
+// Temporary files to delete on cleanup
+int register_owned_temp_file(const char *path);
+void unregister_owned_temp_file(const char *path);
+
+// Create and register /tmp/error_handler_<pid>_XXXXXX; path receives the name.
+// Returns the open descriptor, or -1 on error.
+int create_owned_temp_file(char *path, size_t size);
+
+// Unlink the registered temp files, plus any /tmp/error_handler_<pid>_*
+// regular file of ours whose creating process has exited, with unlinkat()
+// on a directory fd.
+// Returns the number removed.
+int cleanup_temp_files(void);
+
+#endif // RESOURCE_REGISTRY_H
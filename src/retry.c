@@ -0,0 +1,295 @@
+// File: src/retry.c
+#include "retry.h"
+#include "timer_wheel.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#define DEFAULT_RETRY_POLICY { 100, 2000, 2.0, 6000, 0 }
+
+// Attempts that are due run on these threads, not the timer thread, so a
+// slow step does not hold up every other timer
+#define RETRY_WORKERS 2
+// How often a backoff that can be cancelled wakes to check for it
+#define RETRY_CANCEL_CHECK_MS 20
+
+typedef struct RetryState {
+    struct RetryState *next;
+    RetryPolicy policy;
+    RetryStep step;
+    void *step_arg;
+    RetryDoneFn done;
+    void *done_arg;
+    unsigned long long deadline_ns;
+    unsigned long long due_ns;
+    CancelToken *cancel;
+    int attempt;
+    struct timespec started;
+} RetryState;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int finished;
+    RecoveryStatus status;
+    int attempts;
+} RetryWait;
+
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static RetryState *queue_head;
+static RetryState *queue_tail;
+static pthread_once_t workers_once = PTHREAD_ONCE_INIT;
+static int workers_started;
+
+static pthread_mutex_t policy_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// The old fixed schedule was 3 attempts 2 s apart (4 s for a busy device);
+// keep the same overall budget but start retrying much sooner
+static RetryPolicy retry_policies[ERROR_TYPE_COUNT] = {
+    [MEMORY_ERROR] = DEFAULT_RETRY_POLICY,
+    [FILE_ACCESS_ERROR] = DEFAULT_RETRY_POLICY,
+    [INVALID_ARGUMENT] = DEFAULT_RETRY_POLICY,
+    [BAD_FILE_DESCRIPTOR] = DEFAULT_RETRY_POLICY,
+    [WRONG_DEVICE_COMMAND] = DEFAULT_RETRY_POLICY,
+    [DEVICE_ERROR] = DEFAULT_RETRY_POLICY,
+    [NULL_ERROR] = DEFAULT_RETRY_POLICY,
+    [UNKNOWN_ERROR] = DEFAULT_RETRY_POLICY,
+    [TXT_BUSY] = DEFAULT_RETRY_POLICY,
+    [DEVICE_ERROR_ACCESS_FAILURE] = DEFAULT_RETRY_POLICY,
+    [DEVICE_BUSY] = { 200, 4000, 2.0, 12000, 0 },
+};
+
+static __thread uint64_t jitter_state;
+
+static uint64_t next_random(void) {
+    if (jitter_state == 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        jitter_state = ((uint64_t)now.tv_nsec << 32) ^ (uint64_t)now.tv_sec ^ (uintptr_t)&jitter_state;
+        if (jitter_state == 0) {
+            jitter_state = 0x9e3779b97f4a7c15ULL;
+        }
+    }
+    // xorshift64*
+    jitter_state ^= jitter_state >> 12;
+    jitter_state ^= jitter_state << 25;
+    jitter_state ^= jitter_state >> 27;
+    return jitter_state * 0x2545f4914f6cdd1dULL;
+}
+
+static unsigned long elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)((now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000);
+}
+
+void get_retry_policy(ErrorType type, RetryPolicy *policy) {
+    static const RetryPolicy fallback = DEFAULT_RETRY_POLICY;
+    if ((unsigned)type >= ERROR_TYPE_COUNT) {
+        *policy = fallback;
+        return;
+    }
+    pthread_mutex_lock(&policy_mutex);
+    *policy = retry_policies[type];
+    pthread_mutex_unlock(&policy_mutex);
+}
+
+void set_retry_policy(ErrorType type, const RetryPolicy *policy) {
+    if ((unsigned)type >= ERROR_TYPE_COUNT || policy == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&policy_mutex);
+    retry_policies[type] = *policy;
+    pthread_mutex_unlock(&policy_mutex);
+}
+
+unsigned long retry_backoff_ms(const RetryPolicy *policy, int attempt) {
+    double ceiling = (double)policy->base_delay_ms;
+    for (int i = 1; i < attempt && ceiling < (double)policy->max_delay_ms; i++) {
+        ceiling *= policy->multiplier;
+    }
+    if (ceiling > (double)policy->max_delay_ms) {
+        ceiling = (double)policy->max_delay_ms;
+    }
+    unsigned long limit = (unsigned long)ceiling;
+    return limit == 0 ? 0 : (unsigned long)(next_random() % (limit + 1));
+}
+
+// Backoff before the next attempt, or -1 when the policy says to give up
+static int next_delay(const RetryPolicy *policy, int attempt, const struct timespec *started,
+                      unsigned long *delay) {
+    if (policy->max_attempts > 0 && attempt >= policy->max_attempts) {
+        return -1;
+    }
+    *delay = retry_backoff_ms(policy, attempt);
+    if (policy->max_elapsed_ms > 0) {
+        unsigned long spent = elapsed_ms(started);
+        if (spent >= policy->max_elapsed_ms) {
+            return -1;
+        }
+        if (*delay > policy->max_elapsed_ms - spent) {
+            *delay = policy->max_elapsed_ms - spent;
+        }
+    }
+    return 0;
+}
+
+static void retry_finish(RetryState *state, RecoveryStatus status) {
+    state->done(status, state->attempt, state->done_arg);
+    free(state);
+}
+
+static int retry_stopped(const RetryState *state) {
+    return cancel_token_cancelled(state->cancel) || deadline_passed(state->deadline_ns);
+}
+
+static void retry_wake(void *arg);
+
+static void retry_arm(RetryState *state) {
+    unsigned long long now = monotonic_now_ns();
+    unsigned long delay = 0;
+    if (state->due_ns > now) {
+        delay = (unsigned long)((state->due_ns - now + 999999) / 1000000);
+    }
+    if (state->cancel != NULL && delay > RETRY_CANCEL_CHECK_MS) {
+        delay = RETRY_CANCEL_CHECK_MS;
+    }
+    if (timer_schedule(delay, retry_wake, state) != 0) {
+        retry_finish(state, RECOVERY_FAILED);
+    }
+}
+
+static void retry_attempt(RetryState *state) {
+    unsigned long delay;
+    if (retry_stopped(state)) {
+        retry_finish(state, RECOVERY_FAILED);
+        return;
+    }
+    state->attempt++;
+    RetryStepResult result = state->step(state->step_arg, state->attempt);
+    if (result != RETRY_STEP_AGAIN) {
+        retry_finish(state, (RecoveryStatus)result);
+        return;
+    }
+    if (next_delay(&state->policy, state->attempt, &state->started, &delay) != 0) {
+        retry_finish(state, RECOVERY_FAILED);
+        return;
+    }
+    state->due_ns = deadline_after_ms(delay);
+    if (state->deadline_ns != 0 && state->due_ns > state->deadline_ns) {
+        state->due_ns = state->deadline_ns;
+    }
+    retry_arm(state);
+}
+
+static void *retry_worker_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&queue_mutex);
+        while (queue_head == NULL) {
+            pthread_cond_wait(&queue_cond, &queue_mutex);
+        }
+        RetryState *state = queue_head;
+        queue_head = state->next;
+        if (queue_head == NULL) {
+            queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&queue_mutex);
+        retry_attempt(state);
+    }
+    return NULL;
+}
+
+static void start_workers(void) {
+    for (int i = 0; i < RETRY_WORKERS; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, retry_worker_main, NULL) == 0) {
+            pthread_detach(thread);
+            workers_started++;
+        }
+    }
+}
+
+// On the timer thread: finish a retry that was stopped, re-arm one that
+// woke early to look for a cancel, and hand a due attempt to a worker
+static void retry_wake(void *arg) {
+    RetryState *state = arg;
+    if (retry_stopped(state)) {
+        retry_finish(state, RECOVERY_FAILED);
+        return;
+    }
+    if (monotonic_now_ns() < state->due_ns) {
+        retry_arm(state);
+        return;
+    }
+    pthread_once(&workers_once, start_workers);
+    if (workers_started == 0) {
+        retry_attempt(state);
+        return;
+    }
+    state->next = NULL;
+    pthread_mutex_lock(&queue_mutex);
+    if (queue_tail != NULL) {
+        queue_tail->next = state;
+    } else {
+        queue_head = state;
+    }
+    queue_tail = state;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_mutex);
+}
+
+int retry_start(const RetryPolicy *policy, RetryStep step, void *step_arg, unsigned long long deadline_ns,
+                CancelToken *cancel, RetryDoneFn done, void *done_arg) {
+    RetryState *state = malloc(sizeof(*state));
+    if (state == NULL) {
+        return -1;
+    }
+    state->next = NULL;
+    state->policy = *policy;
+    state->step = step;
+    state->step_arg = step_arg;
+    state->done = done;
+    state->done_arg = done_arg;
+    state->deadline_ns = deadline_ns;
+    state->due_ns = 0;
+    state->cancel = cancel;
+    state->attempt = 0;
+    clock_gettime(CLOCK_MONOTONIC, &state->started);
+    retry_attempt(state);
+    return 0;
+}
+
+static void retry_wait_done(RecoveryStatus status, int attempts, void *arg) {
+    RetryWait *wait = arg;
+    pthread_mutex_lock(&wait->mutex);
+    wait->status = status;
+    wait->attempts = attempts;
+    wait->finished = 1;
+    pthread_cond_signal(&wait->cond);
+    pthread_mutex_unlock(&wait->mutex);
+}
+
+RecoveryStatus retry_run_until(const RetryPolicy *policy, RetryStep step, void *arg, int *attempts,
+                               unsigned long long deadline_ns, CancelToken *cancel) {
+    RetryWait wait = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, RECOVERY_FAILED, 0 };
+    if (retry_start(policy, step, arg, deadline_ns, cancel, retry_wait_done, &wait) == 0) {
+        pthread_mutex_lock(&wait.mutex);
+        while (!wait.finished) {
+            pthread_cond_wait(&wait.cond, &wait.mutex);
+        }
+        pthread_mutex_unlock(&wait.mutex);
+    }
+    pthread_cond_destroy(&wait.cond);
+    pthread_mutex_destroy(&wait.mutex);
+    if (attempts) {
+        *attempts = wait.attempts;
+    }
+    return wait.status;
+}
+
+RecoveryStatus retry_run(const RetryPolicy *policy, RetryStep step, void *arg, int *attempts) {
+    return retry_run_until(policy, step, arg, attempts, 0, NULL);
+}
@@ -0,0 +1,58 @@
+// File: src/retry.h
+#ifndef RETRY_H
+#define RETRY_H
+
+#include "error_handler.h"
+#include "recovery.h"
+#include "cancel.h"
+
+// Delay before attempt n+1 is drawn uniformly from
+// [0, min(max_delay_ms, base_delay_ms * multiplier^(n-1))] ("full jitter"),
+// so callers that failed together do not retry together.
+typedef struct {
+    unsigned long base_delay_ms;
+    unsigned long max_delay_ms;
+    double multiplier;
+    unsigned long max_elapsed_ms;   // Give up once this much time has passed; 0 = no limit
+    int max_attempts;               // 0 = no limit
+} RetryPolicy;
+
+// Outcome of one attempt
+typedef enum {
+    RETRY_STEP_SUCCESS = RECOVERY_SUCCESS,
+    RETRY_STEP_PARTIAL = RECOVERY_PARTIAL,
+    RETRY_STEP_FAILED = RECOVERY_FAILED,    // Permanent; stop retrying
+    RETRY_STEP_AGAIN                        // Not yet; try again after a backoff
+} RetryStepResult;
+
+// A single recovery attempt. attempt starts at 1. It may wait briefly (a
+// device probe) but leaves the backoff to the retry.
+typedef RetryStepResult (*RetryStep)(void *arg, int attempt);
+typedef void (*RetryDoneFn)(RecoveryStatus status, int attempts, void *arg);
+
+// Policy used by the built-in recoveries for type, and a way to replace it
+void get_retry_policy(ErrorType type, RetryPolicy *policy);
+void set_retry_policy(ErrorType type, const RetryPolicy *policy);
+
+// Backoff before the attempt following attempt number attempt
+unsigned long retry_backoff_ms(const RetryPolicy *policy, int attempt);
+
+// Run the first attempt now, then schedule the rest on the timer wheel;
+// no thread is held while waiting, and later attempts run on a small pool of
+// retry workers. The retry gives up with RECOVERY_FAILED at deadline_ns
+// (CLOCK_MONOTONIC, 0 = none) or within 20 ms of cancel (optional) being
+// cancelled. done runs exactly once, on the caller's thread if the first
+// attempt settles it, otherwise on the timer or a worker thread, and must
+// not block. Returns 0 if started, -1 if it could not be allocated.
+int retry_start(const RetryPolicy *policy, RetryStep step, void *step_arg, unsigned long long deadline_ns,
+                CancelToken *cancel, RetryDoneFn done, void *done_arg);
+
+// retry_start() for callers that want the outcome: block until done would
+// run and return its status. *attempts (optional) receives the number made.
+RecoveryStatus retry_run(const RetryPolicy *policy, RetryStep step, void *arg, int *attempts);
+
+// retry_run() with a deadline and cancel token, as for retry_start()
+RecoveryStatus retry_run_until(const RetryPolicy *policy, RetryStep step, void *arg, int *attempts,
+                               unsigned long long deadline_ns, CancelToken *cancel);
+
+#endif // RETRY_H
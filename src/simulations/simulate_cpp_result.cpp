@@ -0,0 +1,29 @@
+// File: src/simulations/simulate_cpp_result.cpp
+#include "error_handler.hpp"
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static eh::Result<int> open_readonly(const char *path) {
+    return eh::check_errno(::open(path, O_RDONLY), ERROR_OP_FILE_OPEN, path);
+}
+
+static eh::Result<ssize_t> read_head(const char *path, char *buf, size_t size) {
+    int fd = EH_TRY(open_readonly(path));
+    eh::Result<ssize_t> n = eh::check_errno(::read(fd, buf, size), ERROR_OP_READ_WRITE, path);
+    close(fd);
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : "build/missing.conf";
+    char buf[64];
+
+    printf("Reading %s through eh::Result...\n", path);
+    ssize_t n = read_head(path, buf, sizeof(buf)).value_or_report(-1);
+    if (n < 0) {
+        return 1;
+    }
+    printf("Read %zd bytes\n", n);
+    return 0;
+}
@@ -25,12 +25,11 @@ int main(int argc, char *argv[]) {
             fd = open("/dev/nonexistent_device", O_RDONLY);
             
             if (fd == -1) {
-                printf("Device Error: %s\n", strerror(errno));
+                int err = errno;
+                printf("Device Error: %s\n", strerror(err));
                 
-                if (errno == ENOENT) {
-                    handle_error(DEVICE_ERROR, strerror(errno), errno);
-                }
-                return errno;
+                handle_errno(ERROR_OP_DEVICE_OPEN, err, "/dev/nonexistent_device");
+                return err;
             }
             close(fd);
             break;
@@ -41,8 +40,8 @@ int main(int argc, char *argv[]) {
             // Attempt to issue an IOCTL command to the device
             int ret = ioctl(fd, MY_IOCTL_CMD, NULL);
 
-            if (ret == -1 && errno == ENOTTY) {
-                handle_error(WRONG_DEVICE_COMMAND, strerror(errno), errno);
+            if (ret == -1) {
+                handle_errno(ERROR_OP_IOCTL, errno, "build/sleep");
             }
 
 
@@ -53,15 +52,11 @@ int main(int argc, char *argv[]) {
             fd = open("build/access.txt", O_RDWR);
             
             if (fd == -1) {
-                printf("Device Error: %s\n", strerror(errno));
+                int err = errno;
+                printf("Device Error: %s\n", strerror(err));
                 
-                if (errno == EACCES) {
-                    handle_error(DEVICE_ERROR_ACCESS_FAILURE, strerror(errno), errno);
-                }
-                else{
-                    printf("different error generated");
-                }
-                return errno;
+                handle_errno(ERROR_OP_DEVICE_OPEN, err, "build/access.txt");
+                return err;
             }
             else{
                 printf("unkown problem in the error creation");
@@ -78,9 +73,7 @@ int main(int argc, char *argv[]) {
             }
             // Attempt to lock the file again, which will fail with EAGAIN
             if (flock(fd, LOCK_EX | LOCK_NB) == -1) {
-                if (errno == EBUSY || errno ==EAGAIN) {
-                    handle_error(DEVICE_BUSY, strerror(errno), errno);
-                }
+                handle_errno(ERROR_OP_LOCK, errno, "build/example.lock");
             }else{printf("noerror\n");}
             
             // Clean up
@@ -20,22 +20,22 @@ int main(int argc, char *argv[]) {
         case 1:
             printf("Simulating file access error...\n");
             FILE *file = fopen("build/supper.txt", "r");
-            if (file == NULL && errno==ENOENT) {
-                printf("File Access Error: %s\n", strerror(errno));
-                perror("");
-                handle_error(FILE_ACCESS_ERROR, strerror(errno), errno);
-                return errno;
+            if (file == NULL) {
+                int err = errno;
+                printf("File Access Error: %s\n", strerror(err));
+                handle_errno(ERROR_OP_FILE_OPEN, err, "build/supper.txt");
+                return err;
             }
             fclose(file);
             break;
         case 2:
             printf("Simulating file access error...\n");
             FILE *file1 = fopen("build/supper.txt", "s");
-            if (file1 == NULL && errno==EINVAL) {
-                printf("File Access Error: %s\n", strerror(errno));
-                perror("");
-                handle_error(INVALID_ARGUMENT, strerror(errno), errno);
-                return errno;
+            if (file1 == NULL) {
+                int err = errno;
+                printf("File Access Error: %s\n", strerror(err));
+                handle_errno(ERROR_OP_FILE_OPEN, err, "build/supper.txt");
+                return err;
             }
             fclose(file);
             break;
@@ -45,12 +45,11 @@ int main(int argc, char *argv[]) {
             int fd = open("build/sleep", O_WRONLY|O_TRUNC);
             
             if (fd == -1) {
-                printf("Device Error: %s\n", strerror(errno));
+                int err = errno;
+                printf("Device Error: %s\n", strerror(err));
                 
-                if (errno == ETXTBSY) {
-                    handle_error(TXT_BUSY, strerror(errno), errno);
-                }
-                return errno;
+                handle_errno(ERROR_OP_FILE_OPEN, err, "build/sleep");
+                return err;
             }
             else{
                 printf("run ./sleep in another terminal to get this error as file not running\n");
@@ -64,8 +63,8 @@ int main(int argc, char *argv[]) {
             // Attempt to issue an IOCTL command to the device
             int ret = ioctl(fd, MY_IOCTL_CMD, NULL);
 
-            if (ret == -1 && errno == EBADF) {
-                handle_error(BAD_FILE_DESCRIPTOR, strerror(errno), errno);
+            if (ret == -1) {
+                handle_errno(ERROR_OP_IOCTL, errno, "/build/sleep");
             }
 
             close(fd);
@@ -28,7 +28,7 @@ void simulate_null_pointer_deref() {
         *ptr = 100;
     } else {
         printf("Attempted to dereference a null pointer.\n");
-        handle_error(NULL_ERROR, "Null pointer dereference detected.", 0);
+        EH_ERROR(NULL_ERROR, "Null pointer dereference detected.", 0);
     }
 }
 
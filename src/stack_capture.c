@@ -0,0 +1,152 @@
+// File: src/stack_capture.c
+#define _GNU_SOURCE
+#include "stack_capture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <link.h>
+
+static int capture_depth;
+static StackUnwindMethod capture_method = STACK_UNWIND_FRAME_POINTER;
+static pthread_once_t config_once = PTHREAD_ONCE_INIT;
+
+// Bounds of the current thread's stack, so a broken frame chain stops the walk
+static __thread uintptr_t stack_low;
+static __thread uintptr_t stack_high;
+
+static int thread_stack_bounds(void) {
+    if (stack_high == 0) {
+        pthread_attr_t attr;
+        void *addr;
+        size_t size;
+        if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+            return -1;
+        }
+        pthread_attr_getstack(&attr, &addr, &size);
+        pthread_attr_destroy(&attr);
+        stack_low = (uintptr_t)addr;
+        stack_high = (uintptr_t)addr + size;
+    }
+    return 0;
+}
+
+static void apply_config(int depth, StackUnwindMethod method) {
+    if (depth < 0) {
+        depth = 0;
+    }
+    if (depth > ERROR_STACK_MAX_DEPTH) {
+        depth = ERROR_STACK_MAX_DEPTH;
+    }
+    if (depth > 0 && method == STACK_UNWIND_BACKTRACE) {
+        // The first backtrace() call loads libgcc_s; do it now rather than on an error path
+        void *warmup[1];
+        backtrace(warmup, 1);
+    }
+    if (depth > 0) {
+        // For the main thread this parses /proc/self/maps; do it here too
+        thread_stack_bounds();
+    }
+    capture_method = method;
+    __atomic_store_n(&capture_depth, depth, __ATOMIC_RELEASE);
+}
+
+static void load_config_from_env(void) {
+    const char *depth = getenv("ERROR_STACK_DEPTH");
+    const char *method = getenv("ERROR_STACK_UNWIND");
+    StackUnwindMethod m = STACK_UNWIND_FRAME_POINTER;
+#if !defined(__x86_64__) && !defined(__aarch64__)
+    m = STACK_UNWIND_BACKTRACE;
+#endif
+    if (method && method[0] == 'b') {
+        m = STACK_UNWIND_BACKTRACE;
+    }
+    apply_config(depth ? atoi(depth) : 0, m);
+}
+
+void stack_capture_configure(int depth, StackUnwindMethod method) {
+    pthread_once(&config_once, load_config_from_env);
+    apply_config(depth, method);
+}
+
+int stack_capture_depth(void) {
+    pthread_once(&config_once, load_config_from_env);
+    return __atomic_load_n(&capture_depth, __ATOMIC_ACQUIRE);
+}
+
+__attribute__((noinline))
+int capture_stack(ErrorStack *stack, int skip) {
+    int depth = stack_capture_depth();
+    stack->depth = 0;
+    if (depth <= 0) {
+        return 0;
+    }
+
+    if (capture_method == STACK_UNWIND_BACKTRACE) {
+        // frames[0] is this function, so the caller starts at index 1
+        void *frames[ERROR_STACK_MAX_DEPTH + 8];
+        int want = depth + skip + 1;
+        if (want > (int)(sizeof(frames) / sizeof(frames[0]))) {
+            want = sizeof(frames) / sizeof(frames[0]);
+        }
+        int n = backtrace(frames, want);
+        for (int i = skip + 1; i < n && stack->depth < depth; i++) {
+            stack->frames[stack->depth++] = frames[i];
+        }
+        return stack->depth;
+    }
+
+    if (thread_stack_bounds() != 0) {
+        return 0;
+    }
+    // Each frame holds { saved frame pointer, return address }
+    uintptr_t fp = (uintptr_t)__builtin_frame_address(0);
+    while (stack->depth < depth) {
+        if (fp < stack_low || fp + 2 * sizeof(void *) > stack_high || (fp & (sizeof(void *) - 1))) {
+            break;
+        }
+        uintptr_t next = ((uintptr_t *)fp)[0];
+        void *ret = ((void **)fp)[1];
+        if (ret == NULL) {
+            break;
+        }
+        if (skip > 0) {
+            skip--;
+        } else {
+            stack->frames[stack->depth++] = ret;
+        }
+        if (next <= fp) {
+            break;
+        }
+        fp = next;
+    }
+    return stack->depth;
+}
+
+size_t format_stack(const ErrorStack *stack, char *buf, size_t size) {
+    size_t used = 0;
+    if (size == 0) {
+        return 0;
+    }
+    buf[0] = '\0';
+    for (int i = 0; i < stack->depth && used + 1 < size; i++) {
+        Dl_info info;
+        struct link_map *map = NULL;
+        int n;
+        if (dladdr1(stack->frames[i], &info, (void **)&map, RTLD_DL_LINKMAP) && info.dli_fname && map) {
+            // Offsets are relative to the load bias, which is what addr2line expects
+            n = snprintf(buf + used, size - used, "%s%s+0x%lx", i ? "," : "", info.dli_fname,
+                         (unsigned long)((uintptr_t)stack->frames[i] - map->l_addr));
+        } else {
+            n = snprintf(buf + used, size - used, "%s%p", i ? "," : "", stack->frames[i]);
+        }
+        if (n < 0 || (size_t)n >= size - used) {
+            buf[used] = '\0';
+            break;
+        }
+        used += (size_t)n;
+    }
+    return used;
+}
@@ -0,0 +1,29 @@
+// File: src/stack_capture.h
+#ifndef STACK_CAPTURE_H
+#define STACK_CAPTURE_H
+
+#include "error_handler.h"
+#include <stddef.h>
+
+typedef enum {
+    STACK_UNWIND_FRAME_POINTER,  // Walk saved frame pointers; needs -fno-omit-frame-pointer
+    STACK_UNWIND_BACKTRACE       // glibc backtrace(); slower but works without frame pointers
+} StackUnwindMethod;
+
+// Set how many frames handle_error() captures (0 disables, capped at
+// ERROR_STACK_MAX_DEPTH). The initial value comes from ERROR_STACK_DEPTH.
+void stack_capture_configure(int depth, StackUnwindMethod method);
+int stack_capture_depth(void);
+
+// Capture up to the configured depth of return addresses, skipping the
+// innermost skip frames above the caller. The first capture in a thread
+// looks up its stack bounds with pthread_getattr_np(), which locks and, on
+// the main thread, reads /proc/self/maps with stdio; after that it does not
+// allocate or lock. Enabling capture does the lookup for the calling thread.
+int capture_stack(ErrorStack *stack, int skip);
+
+// Write frames as "module+0xoffset" separated by commas, for
+// tools/symbolize_stack.py. Returns the number of characters written.
+size_t format_stack(const ErrorStack *stack, char *buf, size_t size);
+
+#endif // STACK_CAPTURE_H
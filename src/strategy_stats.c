@@ -0,0 +1,141 @@
+// File: src/strategy_stats.c
+#include "strategy_stats.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define STRATEGY_RESOURCE_MAX 256
+// Device candidates are ranked by path, so names are as long as resources
+#define STRATEGY_NAME_MAX 256
+// Floor on the success rate so a failing strategy sorts last, not infinite
+#define STRATEGY_MIN_SUCCESS 0.01
+
+typedef struct {
+    int used;
+    ErrorType type;
+    char resource[STRATEGY_RESOURCE_MAX];
+    char strategy[STRATEGY_NAME_MAX];
+    double success;      // Decayed success rate
+    double latency_ns;   // Decayed latency of all attempts
+    unsigned long attempts;
+} StrategyStats;
+
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static StrategyStats stats[STRATEGY_STATS_MAX];
+static __thread uint64_t explore_state;
+
+unsigned long long strategy_clock_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+static uint64_t next_random(void) {
+    if (explore_state == 0) {
+        explore_state = strategy_clock_ns() ^ (uintptr_t)&explore_state;
+        if (explore_state == 0) {
+            explore_state = 0x9e3779b97f4a7c15ULL;
+        }
+    }
+    explore_state ^= explore_state >> 12;
+    explore_state ^= explore_state << 25;
+    explore_state ^= explore_state >> 27;
+    return explore_state * 0x2545f4914f6cdd1dULL;
+}
+
+static unsigned int slot_of(ErrorType type, const char *resource, const char *strategy) {
+    uint64_t hash = 0xcbf29ce484222325ULL ^ (uint64_t)type;
+    for (const unsigned char *p = (const unsigned char *)resource; *p; p++) {
+        hash = (hash ^ *p) * 0x100000001b3ULL;
+    }
+    hash = (hash ^ '\0') * 0x100000001b3ULL;
+    for (const unsigned char *p = (const unsigned char *)strategy; *p; p++) {
+        hash = (hash ^ *p) * 0x100000001b3ULL;
+    }
+    return (unsigned int)(hash % STRATEGY_STATS_MAX);
+}
+
+// Caller holds stats_mutex. With create, claims a free slot for a new key;
+// NULL when the key is unknown (or the table is full).
+static StrategyStats *lookup(ErrorType type, const char *resource, const char *strategy, int create) {
+    if (resource == NULL) {
+        resource = "";
+    }
+    if (strlen(resource) >= STRATEGY_RESOURCE_MAX || strlen(strategy) >= STRATEGY_NAME_MAX) {
+        return NULL;
+    }
+    unsigned int slot = slot_of(type, resource, strategy);
+    for (unsigned int i = 0; i < STRATEGY_STATS_MAX; i++) {
+        StrategyStats *entry = &stats[(slot + i) % STRATEGY_STATS_MAX];
+        if (!entry->used) {
+            if (!create) {
+                return NULL;
+            }
+            entry->used = 1;
+            entry->type = type;
+            strcpy(entry->resource, resource);
+            strcpy(entry->strategy, strategy);
+            return entry;
+        }
+        if (entry->type == type && strcmp(entry->resource, resource) == 0 &&
+            strcmp(entry->strategy, strategy) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+void strategy_record(ErrorType type, const char *resource, const char *strategy, int succeeded,
+                     unsigned long long latency_ns) {
+    pthread_mutex_lock(&stats_mutex);
+    StrategyStats *entry = lookup(type, resource, strategy, 1);
+    if (entry != NULL) {
+        double outcome = succeeded ? 1.0 : 0.0;
+        if (entry->attempts == 0) {
+            entry->success = outcome;
+            entry->latency_ns = (double)latency_ns;
+        } else {
+            entry->success += STRATEGY_DECAY * (outcome - entry->success);
+            entry->latency_ns += STRATEGY_DECAY * ((double)latency_ns - entry->latency_ns);
+        }
+        entry->attempts++;
+    }
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+void strategy_order(ErrorType type, const char *resource, const char *const *strategies, int count,
+                    int *order) {
+    double cost[count > 0 ? count : 1];
+    pthread_mutex_lock(&stats_mutex);
+    for (int i = 0; i < count; i++) {
+        StrategyStats *entry = lookup(type, resource, strategies[i], 0);
+        double success = entry ? entry->success : 1.0;
+        if (success < STRATEGY_MIN_SUCCESS) {
+            success = STRATEGY_MIN_SUCCESS;
+        }
+        // Untried strategies cost nothing yet, so each gets tried
+        cost[i] = entry ? entry->latency_ns / success : 0.0;
+        order[i] = i;
+    }
+    pthread_mutex_unlock(&stats_mutex);
+
+    // Insertion sort: stable and count is small
+    for (int i = 1; i < count; i++) {
+        int index = order[i];
+        int j = i;
+        while (j > 0 && cost[order[j - 1]] > cost[index]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = index;
+    }
+
+    if (count > 1 && (double)(next_random() >> 11) / 9007199254740992.0 < STRATEGY_EXPLORE) {
+        int pick = 1 + (int)(next_random() % (uint64_t)(count - 1));
+        int index = order[pick];
+        memmove(&order[1], &order[0], (size_t)pick * sizeof(order[0]));
+        order[0] = index;
+    }
+}
@@ -0,0 +1,31 @@
+// File: src/strategy_stats.h
+#ifndef STRATEGY_STATS_H
+#define STRATEGY_STATS_H
+
+#include "error_handler.h"
+
+// Weight of the newest attempt in the decayed averages
+#define STRATEGY_DECAY 0.2
+// Share of orderings that promote a random strategy to the front, so one
+// that has been failing gets a chance to show it works again
+#define STRATEGY_EXPLORE 0.05
+#define STRATEGY_STATS_MAX 256
+
+// Record one attempt of strategy (e.g. a device path) while recovering
+// type on resource. resource may be NULL.
+void strategy_record(ErrorType type, const char *resource, const char *strategy, int succeeded,
+                     unsigned long long latency_ns);
+
+// Fill order with the indexes of strategies, best first: by expected cost
+// per success (mean latency / success rate), which minimises the expected
+// time to recover when strategies are tried in turn. Strategies without
+// history come first in their given order. Only rank alternatives that are
+// interchangeable; one with a degraded result or side effects must not
+// overtake a clean one just because it has been quicker.
+void strategy_order(ErrorType type, const char *resource, const char *const *strategies, int count,
+                    int *order);
+
+// CLOCK_MONOTONIC in nanoseconds, for timing attempts
+unsigned long long strategy_clock_ns(void);
+
+#endif // STRATEGY_STATS_H
@@ -0,0 +1,227 @@
+// File: src/system_resources.c
+#define _GNU_SOURCE
+#include "system_resources.h"
+#include "resource_registry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define FALLBACK_MEMORY_TOTAL (8ULL * 1024 * 1024)
+
+static pthread_once_t resources_once = PTHREAD_ONCE_INIT;
+static unsigned long long memory_total;
+static long page_size;
+static int statm_fd = -1;
+static int cgroup_current_fd = -1;
+static int cgroup_max_fd = -1;
+static int cgroup_stat_fd = -1;
+static char cgroup_dir[PATH_MAX * 2];
+
+static unsigned long long read_mem_total(void) {
+    FILE *meminfo = fopen("/proc/meminfo", "r");
+    unsigned long long total_kb = 0;
+    char line[256];
+    if (meminfo == NULL) {
+        return FALLBACK_MEMORY_TOTAL;
+    }
+    while (fgets(line, sizeof(line), meminfo)) {
+        if (sscanf(line, "MemTotal: %llu kB", &total_kb) == 1) {
+            break;
+        }
+    }
+    fclose(meminfo);
+    return total_kb ? total_kb * 1024 : FALLBACK_MEMORY_TOTAL;
+}
+
+// Mount point and mount root of the cgroup2 hierarchy, from mountinfo
+static int find_cgroup2_mount(char *mount_point, size_t mount_size, char *root, size_t root_size) {
+    FILE *mountinfo = fopen("/proc/self/mountinfo", "r");
+    char line[1024];
+    int found = 0;
+    if (mountinfo == NULL) {
+        return 0;
+    }
+    while (!found && fgets(line, sizeof(line), mountinfo)) {
+        char mount_root[PATH_MAX], point[PATH_MAX];
+        const char *separator = strstr(line, " - ");
+        if (separator == NULL || strncmp(separator + 3, "cgroup2 ", 8) != 0 ||
+            sscanf(line, "%*s %*s %*s %4095s %4095s", mount_root, point) != 2) {
+            continue;
+        }
+        snprintf(mount_point, mount_size, "%s", point);
+        snprintf(root, root_size, "%s", mount_root);
+        found = 1;
+    }
+    fclose(mountinfo);
+    return found;
+}
+
+// Open a file in cgroup_dir; a path that does not fit is not opened
+static int open_cgroup_file(const char *name) {
+    char path[PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s/%s", cgroup_dir, name);
+    if (len < 0 || (size_t)len >= sizeof(path)) {
+        return -1;
+    }
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+static void open_cgroup_files(void) {
+    char mount_point[PATH_MAX], mount_root[PATH_MAX], group[PATH_MAX] = "";
+    char line[PATH_MAX + 16];
+    if (!find_cgroup2_mount(mount_point, sizeof(mount_point), mount_root, sizeof(mount_root))) {
+        return;
+    }
+    FILE *cgroup = fopen("/proc/self/cgroup", "r");
+    if (cgroup == NULL) {
+        return;
+    }
+    while (fgets(line, sizeof(line), cgroup)) {
+        if (strncmp(line, "0::", 3) == 0) {
+            line[strcspn(line, "\n")] = '\0';
+            int len = snprintf(group, sizeof(group), "%s", line + 3);
+            if (len < 0 || (size_t)len >= sizeof(group)) {
+                group[0] = '\0';
+            }
+            break;
+        }
+    }
+    fclose(cgroup);
+    if (group[0] == '\0') {
+        return;
+    }
+
+    // Outside a cgroup namespace the group path includes the mount's root
+    const char *relative = group;
+    size_t root_len = strlen(mount_root);
+    if (strcmp(mount_root, "/") != 0 && strncmp(group, mount_root, root_len) == 0) {
+        relative = group + root_len;
+    }
+    if (strcmp(relative, "/") == 0) {
+        relative = "";
+    }
+
+    int len = snprintf(cgroup_dir, sizeof(cgroup_dir), "%s%s", mount_point, relative);
+    if (len < 0 || (size_t)len >= sizeof(cgroup_dir)) {
+        cgroup_dir[0] = '\0';
+        return;
+    }
+    cgroup_current_fd = open_cgroup_file("memory.current");
+    cgroup_max_fd = open_cgroup_file("memory.max");
+    if (cgroup_current_fd == -1 || cgroup_max_fd == -1) {
+        if (cgroup_current_fd != -1) {
+            close(cgroup_current_fd);
+        }
+        if (cgroup_max_fd != -1) {
+            close(cgroup_max_fd);
+        }
+        cgroup_current_fd = cgroup_max_fd = -1;
+        return;
+    }
+    // Optional: without it usage includes reclaimable page cache
+    cgroup_stat_fd = open_cgroup_file("memory.stat");
+}
+
+static void init_system_resources(void) {
+    memory_total = read_mem_total();
+    page_size = sysconf(_SC_PAGESIZE);
+    statm_fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    open_cgroup_files();
+    // Cached for the life of the process; cleanup must leave them alone
+    protect_fd(statm_fd);
+    protect_fd(cgroup_current_fd);
+    protect_fd(cgroup_max_fd);
+    protect_fd(cgroup_stat_fd);
+}
+
+// Read a small proc/cgroup file from offset 0 through a cached fd
+static int pread_text(int fd, char *buf, size_t size) {
+    if (fd == -1) {
+        return -1;
+    }
+    ssize_t len = pread(fd, buf, size - 1, 0);
+    if (len <= 0) {
+        return -1;
+    }
+    buf[len] = '\0';
+    return 0;
+}
+
+void system_resources_init(void) {
+    pthread_once(&resources_once, init_system_resources);
+}
+
+unsigned long long system_memory_total(void) {
+    pthread_once(&resources_once, init_system_resources);
+    return memory_total;
+}
+
+unsigned long long process_rss_bytes(void) {
+    char buf[128];
+    unsigned long long size_pages, resident_pages;
+    pthread_once(&resources_once, init_system_resources);
+    if (pread_text(statm_fd, buf, sizeof(buf)) != 0 ||
+        sscanf(buf, "%llu %llu", &size_pages, &resident_pages) != 2) {
+        return 0;
+    }
+    return resident_pages * (unsigned long long)page_size;
+}
+
+// Page cache the kernel can drop without writeback, from memory.stat
+static unsigned long long cgroup_inactive_file(void) {
+    char buf[8192];
+    if (pread_text(cgroup_stat_fd, buf, sizeof(buf)) != 0) {
+        return 0;
+    }
+    const char *field = strstr(buf, "\ninactive_file ");
+    return field ? strtoull(field + 15, NULL, 10) : 0;
+}
+
+int cgroup_memory_usage(unsigned long long *current, unsigned long long *limit) {
+    char buf[64];
+    pthread_once(&resources_once, init_system_resources);
+    if (pread_text(cgroup_current_fd, buf, sizeof(buf)) != 0) {
+        return -1;
+    }
+    *current = strtoull(buf, NULL, 10);
+    // memory.current counts page cache, which fills towards the limit in
+    // normal operation; only the working set says how close we are to OOM
+    unsigned long long inactive = cgroup_inactive_file();
+    *current = inactive < *current ? *current - inactive : 0;
+    if (pread_text(cgroup_max_fd, buf, sizeof(buf)) != 0) {
+        return -1;
+    }
+    *limit = strncmp(buf, "max", 3) == 0 ? ULLONG_MAX : strtoull(buf, NULL, 10);
+    return 0;
+}
+
+int cgroup_file_path(const char *name, char *path, size_t size) {
+    pthread_once(&resources_once, init_system_resources);
+    if (cgroup_dir[0] == '\0') {
+        return -1;
+    }
+    int len = snprintf(path, size, "%s/%s", cgroup_dir, name);
+    return len > 0 && (size_t)len < size ? 0 : -1;
+}
+
+unsigned long long memory_limit_bytes(void) {
+    unsigned long long current, limit;
+    unsigned long long total = system_memory_total();
+    if (cgroup_memory_usage(&current, &limit) == 0 && limit < total) {
+        return limit;
+    }
+    return total;
+}
+
+double memory_usage_ratio(void) {
+    unsigned long long current, limit;
+    unsigned long long total = system_memory_total();
+    if (cgroup_memory_usage(&current, &limit) == 0 && limit < total) {
+        return (double)current / (double)limit;
+    }
+    return (double)process_rss_bytes() / (double)total;
+}
@@ -0,0 +1,38 @@
+// File: src/system_resources.h
+#ifndef SYSTEM_RESOURCES_H
+#define SYSTEM_RESOURCES_H
+
+#include <stddef.h>
+
+// MemTotal, the cgroup v2 memory files and /proc/self/statm are located and
+// opened once on first use; every later query is one or two pread() calls.
+
+// Locate and open everything now (error_handler_init() does this) rather
+// than on the first query
+void system_resources_init(void);
+
+// Physical memory in bytes, read from /proc/meminfo once
+unsigned long long system_memory_total(void);
+
+// Resident set size of this process in bytes, or 0 if unknown
+unsigned long long process_rss_bytes(void);
+
+// Working set (memory.current less inactive_file from memory.stat) and
+// limit of the cgroup v2 this process belongs to. *limit is
+// ULLONG_MAX when memory.max is "max". Returns 0 on success, -1 when there
+// is no cgroup v2 memory controller to read.
+int cgroup_memory_usage(unsigned long long *current, unsigned long long *limit);
+
+// Path of file name inside this process's cgroup v2 directory. Returns 0
+// on success, -1 when there is no cgroup v2 hierarchy.
+int cgroup_file_path(const char *name, char *path, size_t size);
+
+// The memory this process can actually use: the cgroup limit when one is
+// set, otherwise MemTotal
+unsigned long long memory_limit_bytes(void);
+
+// Fraction of memory_limit_bytes() in use: cgroup usage when limited,
+// otherwise this process's RSS
+double memory_usage_ratio(void);
+
+#endif // SYSTEM_RESOURCES_H
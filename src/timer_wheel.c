@@ -0,0 +1,212 @@
+// File: src/timer_wheel.c
+#include "timer_wheel.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+// Four levels of 64 slots: level n holds timers due in [64^n, 64^(n+1)) ticks.
+// A timer moves down a level each time the slot it sits in comes round, so
+// adding and expiring are O(1) whatever the number of pending timers.
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+
+typedef struct Timer {
+    struct Timer *next;
+    uint64_t expires;
+    TimerFn fn;
+    void *arg;
+} Timer;
+
+static Timer *wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static uint64_t wheel_now;
+static unsigned long wheel_pending;
+static struct timespec wheel_epoch;
+
+static pthread_mutex_t wheel_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wheel_cond;
+static pthread_once_t wheel_once = PTHREAD_ONCE_INIT;
+static int wheel_started;
+
+static uint64_t current_tick(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t ms = (int64_t)(now.tv_sec - wheel_epoch.tv_sec) * 1000 +
+                 (now.tv_nsec - wheel_epoch.tv_nsec) / 1000000;
+    return (uint64_t)ms / TIMER_TICK_MS;
+}
+
+static void wheel_insert(Timer *timer) {
+    uint64_t delta = timer->expires - wheel_now;
+    if (delta >= (1ULL << (WHEEL_BITS * WHEEL_LEVELS))) {
+        delta = (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+        timer->expires = wheel_now + delta;
+    }
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    int slot = (int)((timer->expires >> (WHEEL_BITS * level)) & WHEEL_MASK);
+    timer->next = wheel[level][slot];
+    wheel[level][slot] = timer;
+}
+
+// Move to the next tick, pulling timers down from higher levels whose slot
+// has come round, and append the timers that are now due to *expired
+static void wheel_advance(Timer **expired) {
+    wheel_now++;
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        if ((wheel_now & ((1ULL << (WHEEL_BITS * level)) - 1)) != 0) {
+            break;
+        }
+        int slot = (int)((wheel_now >> (WHEEL_BITS * level)) & WHEEL_MASK);
+        Timer *timer = wheel[level][slot];
+        wheel[level][slot] = NULL;
+        while (timer) {
+            Timer *next = timer->next;
+            wheel_insert(timer);
+            timer = next;
+        }
+    }
+
+    int slot = (int)(wheel_now & WHEEL_MASK);
+    Timer *timer = wheel[0][slot];
+    wheel[0][slot] = NULL;
+    while (timer) {
+        Timer *next = timer->next;
+        timer->next = *expired;
+        *expired = timer;
+        wheel_pending--;
+        timer = next;
+    }
+}
+
+// Earliest tick at which the wheel has work: a level 0 slot to fire or a
+// higher slot to cascade. UINT64_MAX when nothing is pending.
+static uint64_t wheel_next_event(void) {
+    uint64_t next = UINT64_MAX;
+    if (wheel_pending == 0) {
+        return next;
+    }
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        int shift = WHEEL_BITS * level;
+        uint64_t base = wheel_now >> shift;
+        for (int step = 1; step <= WHEEL_SIZE; step++) {
+            if (wheel[level][(base + step) & WHEEL_MASK] != NULL) {
+                uint64_t tick = (base + step) << shift;
+                if (tick < next) {
+                    next = tick;
+                }
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+static void *timer_thread_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&wheel_mutex);
+    for (;;) {
+        uint64_t target = current_tick();
+        Timer *expired = NULL;
+        if (wheel_pending == 0) {
+            wheel_now = target;
+        }
+        while (wheel_now < target) {
+            wheel_advance(&expired);
+        }
+
+        if (expired) {
+            pthread_mutex_unlock(&wheel_mutex);
+            while (expired) {
+                Timer *next = expired->next;
+                expired->fn(expired->arg);
+                free(expired);
+                expired = next;
+            }
+            pthread_mutex_lock(&wheel_mutex);
+            continue;
+        }
+
+        uint64_t next = wheel_next_event();
+        if (next == UINT64_MAX) {
+            pthread_cond_wait(&wheel_cond, &wheel_mutex);
+            continue;
+        }
+        uint64_t next_ms = next * TIMER_TICK_MS;
+        struct timespec deadline = wheel_epoch;
+        deadline.tv_sec += (time_t)(next_ms / 1000);
+        deadline.tv_nsec += (long)(next_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&wheel_cond, &wheel_mutex, &deadline);
+    }
+    return NULL;
+}
+
+static void start_timer_thread(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wheel_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    clock_gettime(CLOCK_MONOTONIC, &wheel_epoch);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, timer_thread_main, NULL) != 0) {
+        fprintf(stderr, "Failed to start the timer thread\n");
+        return;
+    }
+    pthread_detach(thread);
+    wheel_started = 1;
+}
+
+int timer_schedule(unsigned long delay_ms, TimerFn fn, void *arg) {
+    pthread_once(&wheel_once, start_timer_thread);
+    if (!wheel_started) {
+        return -1;
+    }
+    Timer *timer = malloc(sizeof(*timer));
+    if (timer == NULL) {
+        return -1;
+    }
+    if (delay_ms > TIMER_MAX_DELAY_MS) {
+        delay_ms = TIMER_MAX_DELAY_MS;
+    }
+    timer->fn = fn;
+    timer->arg = arg;
+
+    pthread_mutex_lock(&wheel_mutex);
+    // The wheel may lag the clock while the thread sleeps; measure from the
+    // real time, and never land on the slot that has already been processed.
+    // The current tick is partly over, so count one more to never fire early.
+    uint64_t now = current_tick() + 1;
+    if (now < wheel_now) {
+        now = wheel_now;
+    } else if (wheel_pending == 0) {
+        wheel_now = now;
+    }
+    uint64_t ticks = (delay_ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+    timer->expires = now + ticks;
+    if (timer->expires <= wheel_now) {
+        timer->expires = wheel_now + 1;
+    }
+    wheel_insert(timer);
+    wheel_pending++;
+    pthread_cond_signal(&wheel_cond);
+    pthread_mutex_unlock(&wheel_mutex);
+    return 0;
+}
+
+unsigned long timer_pending(void) {
+    pthread_mutex_lock(&wheel_mutex);
+    unsigned long pending = wheel_pending;
+    pthread_mutex_unlock(&wheel_mutex);
+    return pending;
+}
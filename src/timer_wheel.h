@@ -0,0 +1,20 @@
+// File: src/timer_wheel.h
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+// Resolution of the wheel and the longest delay it accepts (~4.6 hours);
+// longer delays are clamped
+#define TIMER_TICK_MS 1
+#define TIMER_MAX_DELAY_MS ((1UL << 24) - 1)
+
+typedef void (*TimerFn)(void *arg);
+
+// Call fn(arg) on the timer thread after delay_ms. Callbacks run one at a
+// time and must not block. Starts the timer thread on first use.
+// Returns 0 on success, -1 if the timer could not be allocated.
+int timer_schedule(unsigned long delay_ms, TimerFn fn, void *arg);
+
+// Number of timers waiting to fire
+unsigned long timer_pending(void);
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+# File: tools/symbolize_stack.py
+"""Symbolize the raw stacks that handle_error() appends to log lines.
+
+Usage: symbolize_stack.py [LOG_FILE ...]   (reads stdin when no file is given)
+
+Frames are logged as "module+0xoffset"; they are resolved with addr2line
+against the same binaries, so run this on the host that produced the log
+or point it at an identical build.
+"""
+import re
+import subprocess
+import sys
+
+STACK_RE = re.compile(r" stack=(\S+)$")
+FRAME_RE = re.compile(r"^(.+)\+0x([0-9a-fA-F]+)$")
+
+_cache = {}
+
+
+def symbolize(module, offsets):
+    """Return {offset: "function at file:line"} for one module."""
+    missing = [o for o in offsets if (module, o) not in _cache]
+    if missing:
+        # Return addresses point just past the call; look up the call itself
+        args = ["addr2line", "-f", "-C", "-e", module] + [hex(max(o - 1, 0)) for o in missing]
+        try:
+            out = subprocess.run(args, capture_output=True, text=True, check=True).stdout.splitlines()
+        except (OSError, subprocess.CalledProcessError):
+            out = []
+        for i, offset in enumerate(missing):
+            if 2 * i + 1 < len(out):
+                _cache[(module, offset)] = f"{out[2 * i]} at {out[2 * i + 1]}"
+            else:
+                _cache[(module, offset)] = "??"
+    return {o: _cache[(module, o)] for o in offsets}
+
+
+def process(lines):
+    for line in lines:
+        line = line.rstrip("\n")
+        print(line)
+        match = STACK_RE.search(line)
+        if not match:
+            continue
+        frames = []
+        for frame in match.group(1).split(","):
+            m = FRAME_RE.match(frame)
+            frames.append((m.group(1), int(m.group(2), 16)) if m else (None, frame))
+        by_module = {}
+        for module, offset in frames:
+            if module:
+                by_module.setdefault(module, []).append(offset)
+        resolved = {m: symbolize(m, offs) for m, offs in by_module.items()}
+        for i, (module, offset) in enumerate(frames):
+            if module:
+                print(f"    #{i} {resolved[module][offset]} ({module}+{offset:#x})")
+            else:
+                print(f"    #{i} {offset}")
+
+
+def main():
+    if len(sys.argv) == 1:
+        process(sys.stdin)
+        return
+    for path in sys.argv[1:]:
+        with open(path) as f:
+            process(f)
+
+
+if __name__ == "__main__":
+    main()